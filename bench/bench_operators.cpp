@@ -0,0 +1,69 @@
+// operator-level benchmarks over the TPC-H-style tables of tpch.h; writes JSON to stdout or --out.
+//   sql_bench [--scales 10000,100000,1000000] [--repetitions 3] [--out results.json]
+// scale is the number of lineitems; orders and customers follow the 40:10:1 ratios.
+// input_rows (and so ns/row) counts the rows read, except for the nested-loop join where it counts candidate pairs
+#include <fmt/format.h>
+#include "planner.h"
+#include "tpch.h"
+#include "harness.h"
+
+using namespace ctsql;
+using namespace ctsql::bench;
+
+namespace {
+    static constexpr char scan_filter_q[] = R"(SELECT l_orderkey, l_quantity FROM Lineitem WHERE l_quantity < 24 AND l_discount >= 0.05 AND l_shipdate < 19950101)";
+    static constexpr char projection_q[] = R"(SELECT l_orderkey, l_extendedprice, l_returnflag FROM Lineitem)";
+    static constexpr char global_agg_q[] = R"(SELECT SUM(l_extendedprice), COUNT(*), MAX(l_quantity) FROM Lineitem WHERE l_shipdate <= 19980901)";
+    static constexpr char group_by_low_q[] = R"(SELECT l_returnflag, l_linestatus, SUM(l_quantity), SUM(l_extendedprice), COUNT(*) FROM Lineitem GROUP BY l_returnflag, l_linestatus)";
+    static constexpr char group_by_high_q[] = R"(SELECT l_orderkey, SUM(l_extendedprice) FROM Lineitem GROUP BY l_orderkey)";
+    static constexpr char equi_join_q[] = R"(SELECT o_orderkey, c_name FROM Orders, Customer ON o_custkey = c_custkey WHERE c_mktsegment = 'BUILDING')";
+    static constexpr char nested_loop_join_q[] = R"(SELECT o_orderkey, c_custkey FROM Orders, Customer ON o_totalprice < c_acctbal)";
+
+    using ScanFilter = QueryPlanner<refl::make_const_string(scan_filter_q), Lineitem>;
+    using Projection = QueryPlanner<refl::make_const_string(projection_q), Lineitem>;
+    using GlobalAgg = QueryPlanner<refl::make_const_string(global_agg_q), Lineitem>;
+    using GroupByLow = QueryPlanner<refl::make_const_string(group_by_low_q), Lineitem>;
+    using GroupByHigh = QueryPlanner<refl::make_const_string(group_by_high_q), Lineitem>;
+    using EquiJoin = QueryPlanner<refl::make_const_string(equi_join_q), Orders, Customer>;
+    using NestedLoopJoin = QueryPlanner<refl::make_const_string(nested_loop_join_q), Orders, Customer>;
+
+    // the nested-loop join is quadratic; larger scales are skipped rather than left running for hours
+    static constexpr std::size_t max_nested_loop_pairs = 100'000'000;
+
+    std::size_t count(auto&& results) {
+        std::size_t n = 0;
+        for (auto&& t: results) {
+            keep(t);
+            ++n;
+        }
+        return n;
+    }
+}
+
+int main(int argc, char** argv) {
+    const Options options(argc, argv);
+    std::vector<Measurement> ms;
+    for (std::size_t scale: options.scales) {
+        TpchGenerator gen(scale);
+        auto lineitems = gen.lineitems();
+        auto orders = gen.orders();
+        auto customers = gen.customers();
+        const int reps = options.repetitions;
+
+        ms.push_back(measure("scan_filter", scale, lineitems.size(), reps, [&]() { return count(process<ScanFilter>(lineitems)); }));
+        ms.push_back(measure("projection", scale, lineitems.size(), reps, [&]() { return count(process<Projection>(lineitems)); }));
+        ms.push_back(measure("global_agg", scale, lineitems.size(), reps, [&]() { return count(process<GlobalAgg>(lineitems)); }));
+        ms.push_back(measure("group_by_low", scale, lineitems.size(), reps, [&]() { return count(process<GroupByLow>(lineitems)); }));
+        ms.push_back(measure("group_by_high", scale, lineitems.size(), reps, [&]() { return count(process<GroupByHigh>(lineitems)); }));
+        ms.push_back(measure("equi_join", scale, orders.size() + customers.size(), reps, [&]() {
+            return count(process<EquiJoin>(orders, customers));
+        }));
+        if (orders.size() * customers.size() <= max_nested_loop_pairs) {
+            ms.push_back(measure("nested_loop_join", scale, orders.size() * customers.size(), reps, [&]() {
+                return count(process<NestedLoopJoin>(orders, customers));
+            }));
+        }
+        fmt::print(stderr, "scale {} done\n", scale);
+    }
+    options.write(ms);
+}
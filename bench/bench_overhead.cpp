@@ -0,0 +1,177 @@
+// abstraction overhead: every query is paired with the loop one would write by hand for it, and the ratio of
+// their best times is reported. exits with 1 if any ratio exceeds --max-ratio, or if a pair disagrees on
+// the number of result rows.
+//   sql_bench_overhead [--scales 100000] [--repetitions 5] [--max-ratio 4.0] [--out results.json]
+#include <unordered_map>
+#include <fmt/format.h>
+#include "planner.h"
+#include "tpch.h"
+#include "harness.h"
+
+using namespace ctsql;
+using namespace ctsql::bench;
+
+namespace {
+    static constexpr char scan_filter_q[] = R"(SELECT l_orderkey, l_quantity FROM Lineitem WHERE l_quantity < 24 AND l_discount >= 0.05 AND l_shipdate < 19950101)";
+    static constexpr char global_agg_q[] = R"(SELECT SUM(l_extendedprice), COUNT(*), MAX(l_quantity) FROM Lineitem WHERE l_shipdate <= 19980901)";
+    static constexpr char group_by_low_q[] = R"(SELECT l_returnflag, l_linestatus, SUM(l_quantity), COUNT(*) FROM Lineitem GROUP BY l_returnflag, l_linestatus)";
+    static constexpr char group_by_high_q[] = R"(SELECT l_orderkey, SUM(l_extendedprice) FROM Lineitem GROUP BY l_orderkey)";
+    static constexpr char equi_join_q[] = R"(SELECT o_orderkey, c_name FROM Orders, Customer ON o_custkey = c_custkey WHERE c_mktsegment = 'BUILDING')";
+
+    using ScanFilter = QueryPlanner<refl::make_const_string(scan_filter_q), Lineitem>;
+    using GlobalAgg = QueryPlanner<refl::make_const_string(global_agg_q), Lineitem>;
+    using GroupByLow = QueryPlanner<refl::make_const_string(group_by_low_q), Lineitem>;
+    using GroupByHigh = QueryPlanner<refl::make_const_string(group_by_high_q), Lineitem>;
+    using EquiJoin = QueryPlanner<refl::make_const_string(equi_join_q), Orders, Customer>;
+
+    using LineitemRows = std::vector<SchemaTuple<Lineitem>>;
+    using OrdersRows = std::vector<SchemaTuple<Orders>>;
+    using CustomerRows = std::vector<SchemaTuple<Customer>>;
+
+    // the column positions the hand-written loops read
+    enum { l_orderkey, l_partkey, l_quantity, l_extendedprice, l_discount, l_tax, l_returnflag, l_linestatus, l_shipdate };
+    enum { o_orderkey, o_custkey };
+    enum { c_custkey, c_name, c_nationkey, c_acctbal, c_mktsegment };
+
+    // results are consumed the way a caller would: every row is materialized, then dropped
+    std::size_t count(auto&& results) {
+        std::size_t n = 0;
+        for (auto&& t: results) {
+            keep(t);
+            ++n;
+        }
+        return n;
+    }
+
+    std::size_t scan_filter_by_hand(const LineitemRows& rows) {
+        std::size_t n = 0;
+        for (const auto& r: rows) {
+            if (std::get<l_quantity>(r) < 24 and std::get<l_discount>(r) >= 0.05 and std::get<l_shipdate>(r) < 19950101) {
+                const auto out = std::make_tuple(std::get<l_orderkey>(r), std::get<l_quantity>(r));
+                keep(out);
+                ++n;
+            }
+        }
+        return n;
+    }
+
+    std::size_t global_agg_by_hand(const LineitemRows& rows) {
+        double sum = 0;
+        uint64_t cnt = 0;
+        int max = std::numeric_limits<int>::min();
+        for (const auto& r: rows) {
+            if (std::get<l_shipdate>(r) <= 19980901) {
+                sum += std::get<l_extendedprice>(r);
+                ++cnt;
+                max = std::max(max, std::get<l_quantity>(r));
+            }
+        }
+        keep(std::make_tuple(sum, cnt, max));
+        return 1;
+    }
+
+    std::size_t group_by_low_by_hand(const LineitemRows& rows) {
+        using Key = std::tuple<std::string, std::string>;
+        std::unordered_map<Key, std::tuple<int, uint64_t>, impl::hash_tuple::hash<Key>> groups;
+        for (const auto& r: rows) {
+            auto& acc = groups[Key{std::get<l_returnflag>(r), std::get<l_linestatus>(r)}];
+            std::get<0>(acc) += std::get<l_quantity>(r);
+            ++std::get<1>(acc);
+        }
+        return groups.size();
+    }
+
+    std::size_t group_by_high_by_hand(const LineitemRows& rows) {
+        std::unordered_map<int, double> groups;
+        for (const auto& r: rows) {
+            groups[std::get<l_orderkey>(r)] += std::get<l_extendedprice>(r);
+        }
+        return groups.size();
+    }
+
+    std::size_t equi_join_by_hand(const OrdersRows& orders, const CustomerRows& customers) {
+        std::unordered_multimap<int, const SchemaTuple<Customer>*> building;
+        for (const auto& c: customers) {
+            if (std::get<c_mktsegment>(c) == "BUILDING") {
+                building.emplace(std::get<c_custkey>(c), &c);
+            }
+        }
+        std::size_t n = 0;
+        for (const auto& o: orders) {
+            auto [first, last] = building.equal_range(std::get<o_custkey>(o));
+            for (auto it = first; it != last; ++it) {
+                const auto out = std::make_tuple(std::get<o_orderkey>(o), std::get<c_name>(*it->second));
+                keep(out);
+                ++n;
+            }
+        }
+        return n;
+    }
+
+    struct Pair {
+        Measurement query;
+        Measurement by_hand;
+        double ratio() const { return query.seconds / by_hand.seconds; }
+    };
+
+    void write_json(std::ostream& os, const std::vector<Pair>& pairs, double max_ratio) {
+        os << "{\"max_ratio\": " << max_ratio << ", \"benchmarks\": [";
+        for (std::size_t i = 0; i < pairs.size(); ++i) {
+            const Pair& p = pairs[i];
+            os << (i ? ",\n  " : "\n  ")
+               << "{\"name\": \"" << p.query.name << "\", \"scale\": " << p.query.scale
+               << ", \"query_seconds\": " << p.query.seconds << ", \"hand_written_seconds\": " << p.by_hand.seconds
+               << ", \"query_ns_per_row\": " << ns_per_row(p.query) << ", \"hand_written_ns_per_row\": " << ns_per_row(p.by_hand)
+               << ", \"ratio\": " << p.ratio() << "}";
+        }
+        os << "\n]}\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    const Options options(argc, argv, {100'000}, 5);
+    const double max_ratio = std::stod(options.get("--max-ratio", "4.0"));
+
+    std::vector<Pair> pairs;
+    for (std::size_t scale: options.scales) {
+        TpchGenerator gen(scale);
+        const auto lineitems = gen.lineitems();
+        const auto orders = gen.orders();
+        const auto customers = gen.customers();
+        const int reps = options.repetitions;
+        auto compare = [&](const char* name, std::size_t input_rows, auto query, auto by_hand) {
+            pairs.push_back({measure(name, scale, input_rows, reps, query), measure(name, scale, input_rows, reps, by_hand)});
+        };
+
+        compare("scan_filter", lineitems.size(), [&]() { return count(process<ScanFilter>(lineitems)); },
+                [&]() { return scan_filter_by_hand(lineitems); });
+        compare("global_agg", lineitems.size(), [&]() { return count(process<GlobalAgg>(lineitems)); },
+                [&]() { return global_agg_by_hand(lineitems); });
+        compare("group_by_low", lineitems.size(), [&]() { return count(process<GroupByLow>(lineitems)); },
+                [&]() { return group_by_low_by_hand(lineitems); });
+        compare("group_by_high", lineitems.size(), [&]() { return count(process<GroupByHigh>(lineitems)); },
+                [&]() { return group_by_high_by_hand(lineitems); });
+        compare("equi_join", orders.size() + customers.size(), [&]() { return count(process<EquiJoin>(orders, customers)); },
+                [&]() { return equi_join_by_hand(orders, customers); });
+    }
+
+    if (options.out.empty()) {
+        write_json(std::cout, pairs, max_ratio);
+    } else {
+        std::ofstream file(options.out);
+        write_json(file, pairs, max_ratio);
+    }
+
+    int status = 0;
+    for (const Pair& p: pairs) {
+        if (p.query.output_rows != p.by_hand.output_rows) {
+            fmt::print(stderr, "{} @ {}: the query returned {} rows, the hand-written loop {}\n",
+                       p.query.name, p.query.scale, p.query.output_rows, p.by_hand.output_rows);
+            status = 1;
+        } else if (p.ratio() > max_ratio) {
+            fmt::print(stderr, "{} @ {}: {:.2f}x slower than hand-written (limit {:.2f}x)\n", p.query.name, p.query.scale, p.ratio(), max_ratio);
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,180 @@
+"""compile-time cost of the parser and planner: generates translation units of increasing query complexity and
+records the wall time and peak RSS of compiling each one with every available compiler.
+
+    python3 bench/compile_cost.py [--compilers g++,clang++] [--families columns,and_terms] [--out results.json]
+
+the families grow one dimension at a time up to the limits in include/common.h (MaxNCols, MaxAndTerms,
+MaxOrTerms); `baseline` only includes planner.h, so its cost can be subtracted from the others. `registered`
+is a file that runs n queries declared with CTSQL_DECLARE_QUERY (registry.h), i.e. what a file pays for a query
+defined elsewhere.
+"""
+import argparse
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+def read_limits():
+    with open(os.path.join(ROOT, "include", "common.h")) as f:
+        src = f.read()
+    return {name: int(re.search(rf"{name}\s*=\s*(\d+)", src).group(1)) for name in ["MaxNCols", "MaxAndTerms", "MaxOrTerms"]}
+
+
+def doubling(limit: int):
+    n = 1
+    while n < limit:
+        yield n
+        n *= 2
+    yield limit
+
+
+def tables(num_cols: int):
+    # two tables of int columns; the join family reads from both
+    out = []
+    for name, prefix in [("L", "a"), ("R", "b")]:
+        cols = [f"{prefix}{i}" for i in range(num_cols)]
+        out.append(f"struct {name} {{\n" + "".join(f"    int {c}{{}};\n" for c in cols) + "};\n")
+        out.append(f"REFL_AUTO(type({name}), " + ", ".join(f"field({c})" for c in cols) + ")\n")
+    return "".join(out)
+
+
+def gen_tu(query: str, num_tables: int, num_cols: int):
+    if query is None:
+        body = "int main() {}\n"
+    else:
+        inputs = ", ".join(["ls", "rs"][:num_tables])
+        qp = "QueryPlanner<refl::make_const_string(query_s), L>" if num_tables == 1 else "QueryPlanner<refl::make_const_string(query_s), L, R>"
+        body = f"""static constexpr char query_s[] = R"({query})";
+
+int main() {{
+    std::vector<SchemaTuple<L>> ls(1);
+    std::vector<SchemaTuple<R>> rs(1);
+    std::size_t n = 0;
+    for (auto&& t: process<{qp}>({inputs})) {{
+        (void) t;
+        ++n;
+    }}
+    return static_cast<int>(n);
+}}
+"""
+    return f"""#include <vector>
+#include "planner.h"
+
+{tables(num_cols)}
+using namespace ctsql;
+
+{body}"""
+
+
+def gen_registered_tu(n: int, num_cols: int):
+    decls = "".join(f"CTSQL_DECLARE_QUERY(q{i}, (std::tuple<int>), L);\n" for i in range(n))
+    runs = "".join(f"    for (auto&& t: q{i}::run(ls)) {{ (void) t; ++n; }}\n" for i in range(n))
+    return f"""#include <vector>
+#include "registry.h"
+
+{tables(num_cols)}
+{decls}
+int main() {{
+    std::vector<ctsql::SchemaTuple<L>> ls(1);
+    std::size_t n = 0;
+{runs}    return static_cast<int>(n);
+}}
+"""
+
+
+def gen_cases(limits):
+    cols = limits["MaxNCols"]
+    cases = [("baseline", 0, None, 1)]
+    for n in doubling(cols):
+        cases.append(("columns", n, "SELECT " + ", ".join(f"a{i}" for i in range(n)) + " FROM L", 1))
+    for n in doubling(limits["MaxAndTerms"]):
+        cases.append(("and_terms", n, "SELECT a0 FROM L WHERE " + " AND ".join(f"a{i} < {i + 1}" for i in range(n)), 1))
+    for n in doubling(limits["MaxOrTerms"]):
+        cases.append(("or_terms", n, "SELECT a0 FROM L WHERE " + " OR ".join(f"a{i} < {i + 1}" for i in range(n)), 1))
+    # n equality conditions in the ON clause
+    for n in doubling(limits["MaxAndTerms"]):
+        on = " AND ".join(f"a{i} = b{i}" for i in range(n))
+        cases.append(("join", n, f"SELECT a0, b0 FROM L, R ON {on}", 2))
+    for n in doubling(cols // 2):
+        keys = ", ".join(f"a{i}" for i in range(n))
+        cases.append(("group_by", n, f"SELECT {keys}, SUM(a{cols - 1}), COUNT(*) FROM L GROUP BY {keys}", 1))
+    for n in [1, 8, 64]:
+        cases.append(("registered", n, None, 1))
+    return cases
+
+
+def is_clang(cxx: str):
+    version = subprocess.run([cxx, "--version"], capture_output=True, text=True).stdout
+    return "clang" in version
+
+
+def compile_flags(cxx: str, includes):
+    flags = ["-std=c++20", "-O2", "-c", "-o", os.devnull, "-I", os.path.join(ROOT, "include"), "-I", os.path.join(ROOT, "dep")]
+    flags += [f"-I{inc}" for inc in includes]
+    flags.append("-fconstexpr-steps=114114514" if is_clang(cxx) else "-fconstexpr-ops-limit=114514114514")
+    return flags
+
+
+def measure(cxx: str, flags, path: str):
+    # wait4 gives the rusage of this one child, so the peak RSS is not mixed up with earlier compilations
+    start = time.monotonic()
+    proc = subprocess.Popen([cxx, *flags, path], stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    stderr = proc.stderr.read()
+    _, status, usage = os.wait4(proc.pid, 0)
+    seconds = time.monotonic() - start
+    proc.stderr.close()
+    ok = os.waitstatus_to_exitcode(status) == 0
+    if not ok:
+        sys.stderr.write(stderr.decode(errors="replace")[-4000:])
+    # ru_maxrss covers the largest descendant, i.e. cc1plus rather than the driver; it is in KB on linux
+    return {"ok": ok, "seconds": round(seconds, 3), "peak_rss_kb": usage.ru_maxrss}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--compilers", default="g++,clang++", help="comma-separated; missing ones are skipped")
+    parser.add_argument("--families", default="baseline,columns,and_terms,or_terms,join,group_by,registered")
+    parser.add_argument("--include", action="append", default=[], help="extra include directory, e.g. for boost")
+    parser.add_argument("--keep", help="write the generated translation units to this directory")
+    parser.add_argument("--out", help="JSON output file (default: stdout)")
+    args = parser.parse_args()
+
+    compilers = [c for c in args.compilers.split(",") if shutil.which(c)]
+    if not compilers:
+        sys.exit(f"none of {args.compilers} found")
+    families = set(args.families.split(","))
+    limits = read_limits()
+    cases = [c for c in gen_cases(limits) if c[0] in families]
+
+    workdir = args.keep or tempfile.mkdtemp(prefix="ctsql_compile_cost_")
+    os.makedirs(workdir, exist_ok=True)
+    results = []
+    for family, size, query, num_tables in cases:
+        path = os.path.join(workdir, f"{family}_{size}.cpp")
+        with open(path, "w") as f:
+            f.write(gen_registered_tu(size, limits["MaxNCols"]) if family == "registered" else gen_tu(query, num_tables, limits["MaxNCols"]))
+        for cxx in compilers:
+            m = measure(cxx, compile_flags(cxx, args.include), path)
+            sys.stderr.write(f"{cxx:10} {family:10} {size:3}: {m['seconds']:8.2f}s {m['peak_rss_kb'] / 1024:8.1f}MB{'' if m['ok'] else '  FAILED'}\n")
+            results.append({"compiler": cxx, "family": family, "size": size, "query": query, **m})
+    if not args.keep:
+        shutil.rmtree(workdir)
+
+    report = json.dumps({"limits": limits, "results": results}, indent=2)
+    if args.out:
+        with open(args.out, "w") as f:
+            f.write(report + "\n")
+    else:
+        print(report)
+    sys.exit(0 if all(r["ok"] for r in results) else 1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,137 @@
+#ifndef SQL_BENCH_HARNESS_H
+#define SQL_BENCH_HARNESS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+namespace ctsql::bench {
+    struct Measurement {
+        std::string name;
+        std::size_t scale = 0;
+        std::size_t input_rows = 0;
+        std::size_t output_rows = 0;
+        double seconds = 0;  // best of the repetitions
+        long peak_rss_kb = 0;
+    };
+
+    // the peak RSS (VmHWM) can be reset on linux, which gives a per-benchmark peak; elsewhere the
+    // process-wide maximum is reported
+    inline void reset_peak_rss() {
+        std::ofstream clear_refs("/proc/self/clear_refs");
+        if (clear_refs) {
+            clear_refs << "5";
+        }
+    }
+
+    inline long peak_rss_kb() {
+        std::ifstream status("/proc/self/status");
+        for (std::string line; std::getline(status, line);) {
+            if (line.rfind("VmHWM:", 0) == 0) {
+                return std::strtol(line.c_str() + 6, nullptr, 10);
+            }
+        }
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+    // keeps the optimizer from dropping a result that is otherwise unused
+    template<typename T>
+    inline void keep(const T& value) {
+        asm volatile("" : : "r"(&value) : "memory");
+    }
+
+    // runs `run` (which returns the number of result rows) `repetitions` times and keeps the fastest run
+    template<typename F>
+    Measurement measure(std::string name, std::size_t scale, std::size_t input_rows, int repetitions, F&& run) {
+        Measurement m{std::move(name), scale, input_rows};
+        m.seconds = std::numeric_limits<double>::infinity();
+        reset_peak_rss();
+        for (int i = 0; i < repetitions; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            m.output_rows = run();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            m.seconds = std::min(m.seconds, elapsed.count());
+        }
+        m.peak_rss_kb = peak_rss_kb();
+        return m;
+    }
+
+    inline double rows_per_second(const Measurement& m) {
+        return m.seconds > 0 ? static_cast<double>(m.input_rows) / m.seconds : 0;
+    }
+
+    inline double ns_per_row(const Measurement& m) {
+        return m.input_rows > 0 ? m.seconds * 1e9 / static_cast<double>(m.input_rows) : 0;
+    }
+
+    inline void write_json(std::ostream& os, const std::vector<Measurement>& ms) {
+        os << "{\"benchmarks\": [";
+        for (std::size_t i = 0; i < ms.size(); ++i) {
+            const Measurement& m = ms[i];
+            os << (i ? ",\n  " : "\n  ")
+               << "{\"name\": \"" << m.name << "\", \"scale\": " << m.scale
+               << ", \"input_rows\": " << m.input_rows << ", \"output_rows\": " << m.output_rows
+               << ", \"seconds\": " << m.seconds << ", \"rows_per_sec\": " << rows_per_second(m)
+               << ", \"ns_per_row\": " << ns_per_row(m) << ", \"peak_rss_kb\": " << m.peak_rss_kb << "}";
+        }
+        os << "\n]}\n";
+    }
+
+    // --scales 10000,100000 --repetitions 3 --out results.json, plus whatever extra flags a harness reads
+    struct Options {
+        std::vector<std::size_t> scales;
+        int repetitions;
+        std::string out;  // stdout if empty
+        std::vector<std::pair<std::string, std::string>> extra;
+
+        Options(int argc, char** argv, std::vector<std::size_t> default_scales = {10'000, 100'000, 1'000'000}, int default_repetitions = 3)
+            : scales{std::move(default_scales)}, repetitions{default_repetitions} {
+            for (int i = 1; i + 1 < argc; i += 2) {
+                const std::string flag = argv[i];
+                const std::string value = argv[i + 1];
+                if (flag == "--scales") {
+                    scales.clear();
+                    std::stringstream ss(value);
+                    for (std::string s; std::getline(ss, s, ',');) {
+                        scales.push_back(std::stoull(s));
+                    }
+                } else if (flag == "--repetitions") {
+                    repetitions = std::stoi(value);
+                } else if (flag == "--out") {
+                    out = value;
+                } else {
+                    extra.emplace_back(flag, value);
+                }
+            }
+        }
+
+        std::string get(const std::string& flag, std::string fallback) const {
+            for (const auto& [f, v]: extra) {
+                if (f == flag) {
+                    return v;
+                }
+            }
+            return fallback;
+        }
+
+        void write(const std::vector<Measurement>& ms) const {
+            if (out.empty()) {
+                write_json(std::cout, ms);
+            } else {
+                std::ofstream file(out);
+                write_json(file, ms);
+            }
+        }
+    };
+}
+
+#endif //SQL_BENCH_HARNESS_H
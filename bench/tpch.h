@@ -0,0 +1,143 @@
+#ifndef SQL_BENCH_TPCH_H
+#define SQL_BENCH_TPCH_H
+
+#include <array>
+#include <random>
+#include <string>
+#include <vector>
+#include "refl.hpp"
+#include "common.h"
+
+// a cut-down TPC-H: lineitem, orders and customer with the usual 40:10:1 row ratios
+struct Lineitem {
+    int l_orderkey{};
+    int l_partkey{};
+    int l_quantity{};
+    double l_extendedprice{};
+    double l_discount{};
+    double l_tax{};
+    std::string l_returnflag;
+    std::string l_linestatus;
+    int l_shipdate{};  // yyyymmdd
+};
+
+struct Orders {
+    int o_orderkey{};
+    int o_custkey{};
+    std::string o_orderstatus;
+    double o_totalprice{};
+    int o_orderdate{};
+};
+
+struct Customer {
+    int c_custkey{};
+    std::string c_name;
+    int c_nationkey{};
+    double c_acctbal{};
+    std::string c_mktsegment;
+};
+
+REFL_AUTO(
+    type(Lineitem),
+    field(l_orderkey),
+    field(l_partkey),
+    field(l_quantity),
+    field(l_extendedprice),
+    field(l_discount),
+    field(l_tax),
+    field(l_returnflag),
+    field(l_linestatus),
+    field(l_shipdate)
+)
+
+REFL_AUTO(
+    type(Orders),
+    field(o_orderkey),
+    field(o_custkey),
+    field(o_orderstatus),
+    field(o_totalprice),
+    field(o_orderdate)
+)
+
+REFL_AUTO(
+    type(Customer),
+    field(c_custkey),
+    field(c_name),
+    field(c_nationkey),
+    field(c_acctbal),
+    field(c_mktsegment)
+)
+
+namespace ctsql::bench {
+    // deterministic across platforms: only the raw engine output is used, never the std distributions
+    class TpchGenerator {
+    public:
+        explicit TpchGenerator(std::size_t num_lineitems, uint64_t seed = 42): num_lineitems{num_lineitems}, engine{seed} {}
+
+        std::size_t num_orders() const { return std::max<std::size_t>(num_lineitems / 4, 1); }
+        std::size_t num_customers() const { return std::max<std::size_t>(num_lineitems / 40, 1); }
+
+        std::vector<SchemaTuple<Lineitem>> lineitems() {
+            static constexpr std::array<std::string_view, 3> flags{"A", "N", "R"};
+            static constexpr std::array<std::string_view, 2> statuses{"F", "O"};
+            std::vector<SchemaTuple<Lineitem>> rows;
+            rows.reserve(num_lineitems);
+            for (std::size_t i = 0; i < num_lineitems; ++i) {
+                const int quantity = uniform(1, 50);
+                rows.emplace_back(schema_to_tuple(Lineitem{
+                    static_cast<int>(i / 4), uniform(1, 200'000), quantity, quantity * (uniform(90'000, 200'000) / 100.0),
+                    uniform(0, 10) / 100.0, uniform(0, 8) / 100.0,
+                    std::string(flags[uniform(0, 2)]), std::string(statuses[uniform(0, 1)]), date()}));
+            }
+            return rows;
+        }
+
+        std::vector<SchemaTuple<Orders>> orders() {
+            static constexpr std::array<std::string_view, 3> statuses{"F", "O", "P"};
+            std::vector<SchemaTuple<Orders>> rows;
+            rows.reserve(num_orders());
+            for (std::size_t i = 0; i < num_orders(); ++i) {
+                rows.emplace_back(schema_to_tuple(Orders{
+                    static_cast<int>(i), uniform(0, static_cast<int>(num_customers()) - 1), std::string(statuses[uniform(0, 2)]),
+                    money(1'000, 500'000), date()}));
+            }
+            return rows;
+        }
+
+        std::vector<SchemaTuple<Customer>> customers() {
+            static constexpr std::array<std::string_view, 5> segments{"AUTOMOBILE", "BUILDING", "FURNITURE", "HOUSEHOLD", "MACHINERY"};
+            std::vector<SchemaTuple<Customer>> rows;
+            rows.reserve(num_customers());
+            for (std::size_t i = 0; i < num_customers(); ++i) {
+                rows.emplace_back(schema_to_tuple(Customer{
+                    static_cast<int>(i), "Customer#" + std::to_string(i), uniform(0, 24),
+                    money(-999, 9999), std::string(segments[uniform(0, 4)])}));
+            }
+            return rows;
+        }
+
+    private:
+        int uniform(int lo, int hi) {
+            return lo + static_cast<int>(engine() % static_cast<uint64_t>(hi - lo + 1));
+        }
+
+        // operands of + are unsequenced, so every draw is its own statement
+        double money(int lo, int hi) {
+            const int units = uniform(lo, hi);
+            const int cents = uniform(0, 99);
+            return units + cents / 100.0;
+        }
+
+        int date() {
+            const int year = uniform(1992, 1998);
+            const int month = uniform(1, 12);
+            const int day = uniform(1, 28);
+            return year * 10000 + month * 100 + day;
+        }
+
+        std::size_t num_lineitems;
+        std::mt19937_64 engine;
+    };
+}
+
+#endif //SQL_BENCH_TPCH_H
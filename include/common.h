@@ -7,6 +7,7 @@
 #include <utility>
 #include <cassert>
 #include <concepts>
+#include <functional>
 #include "ctpg.hpp"
 #include "refl.hpp"
 
@@ -35,7 +36,7 @@ namespace ctsql {
         }
         throw std::runtime_error("unknown agg");
     }
-    std::ostream& operator<<(std::ostream& os, AggOp agg) {
+    inline std::ostream& operator<<(std::ostream& os, AggOp agg) {
         os << to_str(agg);
         return os;
     }
@@ -112,7 +113,7 @@ namespace ctsql {
         }
         throw std::runtime_error("unknown comparison operator");
     }
-    std::ostream& operator<<(std::ostream& os, CompOp cop) {
+    inline std::ostream& operator<<(std::ostream& os, CompOp cop) {
         os << to_str(cop);
         return os;
     }
@@ -188,7 +189,7 @@ namespace ctsql {
         std::optional<TableName> second;
     };
 
-    std::ostream& operator<<(std::ostream& os, const TableNames& tns) {
+    inline std::ostream& operator<<(std::ostream& os, const TableNames& tns) {
         os << tns.first << ", ";
         if (tns.second) {
             os << tns.second.value();
@@ -209,10 +210,18 @@ namespace ctsql {
         return os;
     }
 
+    // a ? or :name placeholder on the right-hand side of a WHERE atom; its value is read from the bind tuple at run time.
+    // placeholders are numbered in order of appearance, with a repeated :name sharing its index (see number_params)
+    struct Param {
+        std::string_view name;  // empty for ?
+        std::size_t index = 0;
+        constexpr bool operator==(const Param&) const = default;
+    };
+
     // we assume that one side of the clause will be a column name reference
     template<bool one_side=true>
     struct BooleanFactor {
-        using RHSType = std::conditional_t<one_side, std::variant<std::string_view, int64_t, double>, BasicColumnName>;
+        using RHSType = std::conditional_t<one_side, std::variant<std::string_view, int64_t, double, Param>, BasicColumnName>;
         CompOp cop{};
         BasicColumnName lhs;
         RHSType rhs;
@@ -227,6 +236,12 @@ namespace ctsql {
             std::visit([&os](auto v) {
             if constexpr (std::is_same_v<decltype(v), std::string_view>) {
                 os << '\"' << v << '\"';
+            } else if constexpr (std::is_same_v<decltype(v), Param>) {
+                if (v.name.empty()) {
+                    os << '?';
+                } else {
+                    os << ':' << v.name;
+                }
             } else {
                 os << v;
             }}, be.rhs);
@@ -241,17 +256,43 @@ namespace ctsql {
     template<bool one_side>
     using BooleanOrTerms = ctpg::stdex::cvector<BooleanAndTerms<one_side>, MaxOrTerms>;
 
+    // one key of an ORDER BY clause; refers to a column of the select list (by name or alias)
+    struct OrderKey {
+        ColumnName column;
+        bool descending = false;
+        constexpr OrderKey() = default;
+        constexpr OrderKey(ColumnName column, bool descending): column{column}, descending{descending} {}
+        friend std::ostream& operator<<(std::ostream& os, OrderKey ok) {
+            os << ok.column << (ok.descending ? " DESC" : " ASC");
+            return os;
+        }
+    };
+    using OrderKeys = ctpg::stdex::cvector<OrderKey, MaxNCols>;
+
     struct Query {
         ColumnNames cns;
         TableNames tns;
         BooleanOrTerms<false> join_condition;
         BooleanOrTerms<true> where_condition;
         ColumnNames group_by_keys;
+        OrderKeys order_by;
+        std::optional<std::size_t> limit;
         constexpr Query() = default;
         constexpr Query(ColumnNames cns, TableNames tns, BooleanOrTerms<false> join_condition, BooleanOrTerms<true> where_condition, ColumnNames group_by_keys):
             cns{cns}, tns{tns}, join_condition{join_condition}, where_condition{where_condition}, group_by_keys{group_by_keys} {}
     };
 
+    // values for the placeholders of a prepared query, in placeholder order
+    template<typename... Ts>
+    struct Params {
+        std::tuple<Ts...> values;
+    };
+
+    template<typename... Ts>
+    constexpr auto bind_params(Ts... values) {
+        return Params<Ts...>{{std::move(values)...}};
+    }
+
     // for selector-making
     template<typename T>
     concept Reflectable = refl::is_reflectable<T>() or std::is_void_v<T>;
@@ -262,7 +303,7 @@ namespace ctsql {
     };
 
     enum class RHSTypeTag {
-        INT=0, DOUBLE, STRING, COLNAME
+        INT=0, DOUBLE, STRING, COLNAME, PARAM
     };
 
     // schema object => tuple with field values
@@ -317,11 +358,80 @@ namespace ctsql {
         }
     }
 
+namespace impl {
+    // CREDIT: https://stackoverflow.com/questions/7110301/generic-hash-for-tuples-in-unordered-map-unordered-set
+    // usage be like: unordered_set<tuple<double, int>, hash_tuple::hash<tuple<double, int>>> dict;
+    namespace hash_tuple{
+        template <typename TT>
+        struct hash
+        {
+            size_t
+            operator()(TT const& tt) const
+            {
+                return std::hash<TT>()(tt);
+            }
+        };
+
+        namespace {
+            template <class T>
+            inline void hash_combine(std::size_t& seed, T const& v)
+            {
+                seed ^= hash_tuple::hash<T>()(v) + 0x9e3779b9 + (seed<<6) + (seed>>2);
+            }
+        }
+
+        namespace {
+            // Recursive template code derived from Matthieu M.
+            template <class Tuple, size_t Index = std::tuple_size<Tuple>::value - 1>
+            struct HashValueImpl
+            {
+                static void apply(size_t& seed, Tuple const& tuple)
+                {
+                    HashValueImpl<Tuple, Index-1>::apply(seed, tuple);
+                    hash_combine(seed, std::get<Index>(tuple));
+                }
+            };
+
+            template <class Tuple>
+            struct HashValueImpl<Tuple,0>
+            {
+                static void apply(size_t& seed, Tuple const& tuple)
+                {
+                    hash_combine(seed, std::get<0>(tuple));
+                }
+            };
+        }
+
+        template <typename ... TT>
+        struct hash<std::tuple<TT...>>
+        {
+            size_t
+            operator()(std::tuple<TT...> const& tt) const
+            {
+                size_t seed = 0;
+                HashValueImpl<std::tuple<TT...> >::apply(seed, tt);
+                return seed;
+            }
+        };
+
+        // the key of a query without GROUP BY
+        template <>
+        struct hash<std::tuple<>>
+        {
+            size_t
+            operator()(std::tuple<> const&) const
+            {
+                return 0;
+            }
+        };
+    }
+}
+
     // generate a filtered range
     template<auto pred>
-    static auto filter(std::ranges::range auto& input) -> std::generator<std::ranges::range_value_t<decltype(input)>> {
+    static auto filter(std::ranges::range auto& input, const auto&... params) -> std::generator<std::ranges::range_value_t<decltype(input)>> {
         for (auto&& inp: input) {
-            if (pred(inp)) {
+            if (pred(inp, params...)) {
                 co_yield inp;
             }
         }
@@ -0,0 +1,130 @@
+#ifndef SQL_HASH_INDEX_H
+#define SQL_HASH_INDEX_H
+
+#include <vector>
+#include <span>
+#include <unordered_map>
+#include "common.h"
+#include "operator/selector.h"
+#include "operator/projector.h"
+#include "index/indexed_table.h"
+
+namespace ctsql {
+    // secondary index over one or more reflected columns: row ids of a table grouped by the column values.
+    // meant to be built once per table version and then reused for point lookups and as a prebuilt join build side
+    template<Reflectable Schema, refl::const_string... columns>
+    class HashIndex {
+    public:
+        static_assert(sizeof...(columns) > 0, "index on at least one column");
+        using SchemaType = Schema;
+        using STuple = SchemaTuple<Schema>;
+        static constexpr std::array<std::size_t, sizeof...(columns)> key_indices{get_index<Schema, void>(BasicColumnName{"", columns.str_view()})...};
+        static_assert(std::all_of(key_indices.begin(), key_indices.end(), [](std::size_t i){ return i < member_list<Schema>.size(); }),
+                      "indexed column does not exist in the schema");
+        static constexpr auto key_projector = impl::make_projector<key_indices>();
+        using Key = impl::ProjectedTuple<STuple, key_indices>;
+        using Dict = std::unordered_map<Key, std::vector<std::size_t>, impl::hash_tuple::hash<Key>>;
+
+        HashIndex() = default;
+        explicit HashIndex(const std::ranges::random_access_range auto& table) { rebuild(table); }
+
+        void rebuild(const std::ranges::random_access_range auto& table) {
+            dict.clear();
+            num_rows = 0;
+            append(table);
+        }
+
+        // index the rows that were appended to the table since the last (re)build
+        void append(const std::ranges::random_access_range auto& table) {
+            const std::size_t n = std::ranges::size(table);
+            for (; num_rows < n; ++num_rows) {
+                dict[key_projector(table[num_rows])].push_back(num_rows);
+            }
+        }
+
+        [[nodiscard]] std::size_t size() const { return num_rows; }
+
+        [[nodiscard]] std::span<const std::size_t> lookup(const Key& key) const {
+            auto pos = dict.find(key);
+            if (pos == dict.end()) {
+                return {};
+            }
+            return pos->second;
+        }
+
+    private:
+        Dict dict;
+        std::size_t num_rows = 0;
+    };
+
+namespace impl {
+    template<typename T>
+    concept IsHashIndex = requires(const T& index) {
+        T::key_indices;
+        index.lookup(std::declval<typename T::Key>());
+    };
+
+    // access path for a CNF over a base table with a hash index:
+    // usable if, for every indexed column, some CNF clause is a single equality on that column.
+    // the row ids under the resulting key are the only candidates; every other clause is checked on them
+    template<Reflectable S, typename CNFSource, typename Index>
+    struct PointLookup {
+        using Atoms = AtomTable<S, void, true, CNFSource::cnf, CNFSource::inner_dim>;
+        static constexpr std::size_t key_size = Index::key_indices.size();
+
+        // for each key column, the atom providing its value (Atoms::size if there is none)
+        static constexpr auto key_atoms = []() {
+            std::array<std::size_t, key_size> arr{};
+            for (std::size_t k = 0; k < key_size; ++k) {
+                arr[k] = Atoms::size;
+                for (AtomMask clause: Atoms::masks) {
+                    if (std::has_single_bit(clause)) {
+                        const std::size_t i = std::countr_zero(clause);
+                        if (Atoms::lhs_indices[i] == Index::key_indices[k] and Atoms::atoms[i].cop == CompOp::EQ and arr[k] == Atoms::size) {
+                            arr[k] = i;
+                        }
+                    }
+                }
+            }
+            return arr;
+        }();
+
+        template<std::size_t... Idx>
+        static constexpr bool answerable(std::index_sequence<Idx...>) {
+            return (... and (key_atoms[Idx] < Atoms::size
+                             and is_index_answerable<std::remove_cvref_t<std::tuple_element_t<Idx, typename Index::Key>>, true>(Atoms::atoms[key_atoms[Idx]])));
+        }
+        static constexpr bool usable = answerable(std::make_index_sequence<key_size>());
+
+        static constexpr AtomMask answered = []() {
+            AtomMask m = 0;
+            for (auto i: key_atoms) {
+                if (i < Atoms::size) {
+                    m |= AtomMask{1} << i;
+                }
+            }
+            return m;
+        }();
+        using Residual = ResidualCNF<S, CNFSource, answered>;
+
+        // the literals convert to Key without change, see is_index_answerable
+        template<std::size_t... Idx>
+        static auto make_key(std::index_sequence<Idx...>) {
+            return typename Index::Key{static_cast<std::remove_cvref_t<std::tuple_element_t<Idx, typename Index::Key>>>(
+                    std::get<RHS<Atoms::rhs_types[key_atoms[Idx]]>>(Atoms::atoms[key_atoms[Idx]].rhs))...};
+        }
+
+        static std::generator<SchemaTuple<S>> scan(const IsIndexedTable auto& input) {
+            check_index_fresh(input.index.size(), std::ranges::size(input.table));
+            for (auto row_id: input.index.lookup(make_key(std::make_index_sequence<key_size>()))) {
+                const auto& tuple = input.table[row_id];
+                if (Residual::accepts(tuple)) {
+                    co_yield tuple;
+                }
+            }
+        }
+    };
+}
+}
+
+#endif //SQL_HASH_INDEX_H
@@ -0,0 +1,110 @@
+#ifndef SQL_INDEXED_TABLE_H
+#define SQL_INDEXED_TABLE_H
+
+#include <bit>
+#include <limits>
+#include "common.h"
+#include "operator/selector.h"
+
+namespace ctsql {
+    // a base table bundled with an index built over it.
+    // it iterates exactly like the table itself, so any operator that cannot make use of the index simply sees a full scan
+    template<std::ranges::random_access_range Table, typename Index>
+    struct IndexedTable {
+        using IndexType = Index;
+        const Table& table;
+        const Index& index;
+        auto begin() const { return std::ranges::begin(table); }
+        auto end() const { return std::ranges::end(table); }
+        auto size() const { return std::ranges::size(table); }
+    };
+
+    template<std::ranges::random_access_range Table, typename Index>
+    constexpr auto with_index(const Table& table, const Index& index) {
+        return IndexedTable<Table, Index>{table, index};
+    }
+
+namespace impl {
+    template<typename T>
+    concept IsIndexedTable = requires(const T& t) {
+        typename T::IndexType;
+        t.table;
+        t.index;
+    };
+
+    // whether an atom can be answered by looking up its right-hand side in an index keyed on Key.
+    // exact lookups (hash) need an rhs of the very same kind that Key holds without change: a literal it cannot hold
+    // (0.1 for a float key, 4294967297 for an int one) equals no row, but its conversion would find some.
+    // ordered lookups can compare across int/double
+    template<typename Key, bool exact>
+    constexpr bool is_index_answerable(const BooleanFactor<true>& atom) {
+        if (std::holds_alternative<Param>(atom.rhs)) {  // value unknown until run time
+            return false;
+        }
+        if constexpr (std::is_integral_v<Key>) {
+            if (const auto* v = std::get_if<int64_t>(&atom.rhs)) {
+                return not exact or static_cast<int64_t>(static_cast<Key>(*v)) == *v;
+            }
+            return not exact and std::holds_alternative<double>(atom.rhs);
+        } else if constexpr (std::is_arithmetic_v<Key>) {
+            if (const auto* v = std::get_if<double>(&atom.rhs)) {  // an integer is compared as a Key, and always is one
+                return not exact or (std::numeric_limits<Key>::lowest() <= *v and *v <= std::numeric_limits<Key>::max()
+                                     and static_cast<double>(static_cast<Key>(*v)) == *v);
+            }
+            return not std::holds_alternative<std::string_view>(atom.rhs);
+        } else {
+            return std::holds_alternative<std::string_view>(atom.rhs);
+        }
+    }
+
+    // the part of a CNF that an index cannot answer: any clause mentioning an answered atom is implied by the lookup
+    template<Reflectable S, typename CNFSource, AtomMask answered>
+    struct ResidualCNF {
+        using Atoms = AtomTable<S, void, true, CNFSource::cnf, CNFSource::inner_dim>;
+        static constexpr std::size_t num_clauses = std::count_if(Atoms::raw_masks.begin(), Atoms::raw_masks.end(),
+                                                                 [](AtomMask clause){ return (clause & answered) == 0; });
+        static constexpr auto cnf = []() {
+            using Clause = std::remove_cvref_t<decltype(CNFSource::cnf[0])>;
+            std::array<Clause, num_clauses> arr{};
+            for (std::size_t i = 0, k = 0; i < Atoms::raw_masks.size(); ++i) {
+                if ((Atoms::raw_masks[i] & answered) == 0) {
+                    arr[k++] = CNFSource::cnf[i];
+                }
+            }
+            return arr;
+        }();
+        static constexpr auto inner_dim = make_inner_dim<cnf.size()>(CNFSource::inner_dim.empty() ? 0 : CNFSource::inner_dim[0]);
+        using ResidualAtoms = AtomTable<S, void, true, cnf, inner_dim>;
+        static constexpr std::optional selector = cnf.empty() ? std::nullopt : std::optional{make_cnf_selector<ResidualAtoms>()};
+
+        static constexpr bool accepts(const auto& tuple) {
+            if constexpr (selector) {
+                return selector.value()(tuple);
+            } else {
+                return true;
+            }
+        }
+    };
+
+    // answered atoms, in order of appearance
+    template<typename Atoms, AtomMask answered>
+    constexpr auto pick_atoms() {
+        std::array<BooleanFactor<true>, std::popcount(answered)> arr{};
+        for (std::size_t i = 0, k = 0; i < Atoms::size; ++i) {
+            if (answered & (AtomMask{1} << i)) {
+                arr[k++] = Atoms::atoms[i];
+            }
+        }
+        return arr;
+    }
+
+    // indices remember the number of rows they were built on; a mismatch means the table changed underneath
+    inline void check_index_fresh(std::size_t index_size, std::size_t table_size) {
+        if (index_size != table_size) {
+            throw std::runtime_error("index is stale; rebuild it after modifying the table");
+        }
+    }
+}
+}
+
+#endif //SQL_INDEXED_TABLE_H
@@ -0,0 +1,124 @@
+#ifndef SQL_SORTED_INDEX_H
+#define SQL_SORTED_INDEX_H
+
+#include <vector>
+#include <numeric>
+#include "common.h"
+#include "operator/selector.h"
+#include "index/indexed_table.h"
+
+namespace ctsql {
+    // secondary index over one reflected column: the row ids of a table ordered by that column.
+    // the keys are copied next to the row ids so that binary search does not chase row ids into the table
+    template<Reflectable Schema, refl::const_string column>
+    class SortedIndex {
+    public:
+        using SchemaType = Schema;
+        using STuple = SchemaTuple<Schema>;
+        static constexpr std::size_t key_index = get_index<Schema, void>(BasicColumnName{"", column.str_view()});
+        static_assert(key_index < member_list<Schema>.size(), "indexed column does not exist in the schema");
+        using Key = std::remove_cvref_t<std::tuple_element_t<key_index, STuple>>;
+
+        SortedIndex() = default;
+        explicit SortedIndex(const std::ranges::random_access_range auto& table) { rebuild(table); }
+
+        void rebuild(const std::ranges::random_access_range auto& table) {
+            row_ids.resize(std::ranges::size(table));
+            std::iota(row_ids.begin(), row_ids.end(), std::size_t{0});
+            std::stable_sort(row_ids.begin(), row_ids.end(), [&table](std::size_t a, std::size_t b) {
+                return std::get<key_index>(table[a]) < std::get<key_index>(table[b]);
+            });
+            keys.clear();
+            keys.reserve(row_ids.size());
+            for (auto row_id: row_ids) {
+                keys.emplace_back(std::get<key_index>(table[row_id]));
+            }
+        }
+
+        [[nodiscard]] std::size_t size() const { return row_ids.size(); }
+        [[nodiscard]] std::size_t row_id(std::size_t pos) const { return row_ids[pos]; }
+
+        // shrink the position range [lo, hi) to the entries whose key satisfies "key cop v"
+        template<CompOp cop>
+        void narrow(const auto& v, std::size_t& lo, std::size_t& hi) const {
+            const auto first = keys.begin() + lo;
+            const auto last = keys.begin() + hi;
+            if constexpr (cop == CompOp::EQ) {
+                const auto [eq_first, eq_last] = std::equal_range(first, last, v);
+                lo = eq_first - keys.begin();
+                hi = eq_last - keys.begin();
+            } else if constexpr (cop == CompOp::GT) {
+                lo = std::upper_bound(first, last, v) - keys.begin();
+            } else if constexpr (cop == CompOp::GEQ) {
+                lo = std::lower_bound(first, last, v) - keys.begin();
+            } else if constexpr (cop == CompOp::LT) {
+                hi = std::lower_bound(first, last, v) - keys.begin();
+            } else {
+                static_assert(cop == CompOp::LEQ, "<> cannot be answered by a range");
+                hi = std::upper_bound(first, last, v) - keys.begin();
+            }
+        }
+
+    private:
+        std::vector<std::size_t> row_ids;
+        std::vector<Key> keys;
+    };
+
+namespace impl {
+    template<typename T>
+    concept IsSortedIndex = requires(const T& index, std::size_t& pos) {
+        T::key_index;
+        index.template narrow<CompOp::EQ>(std::declval<typename T::Key>(), pos, pos);
+    };
+
+    // access path for a CNF over a base table with a sorted index:
+    // clauses that are a single comparison on the indexed column narrow down a contiguous key range,
+    // every other clause is checked on the candidate rows only.
+    // CNFSource provides the CNF matrix (cnf) and the length of its clauses (inner_dim)
+    template<Reflectable S, typename CNFSource, typename Index>
+    struct RangeScan {
+        using Atoms = AtomTable<S, void, true, CNFSource::cnf, CNFSource::inner_dim>;
+        static constexpr std::size_t key_index = Index::key_index;
+
+        static constexpr AtomMask bound_atoms = []() {
+            AtomMask bounds = 0;
+            for (AtomMask clause: Atoms::masks) {
+                if (std::has_single_bit(clause)) {
+                    const auto i = std::countr_zero(clause);
+                    if (Atoms::lhs_indices[i] == key_index and Atoms::atoms[i].cop != CompOp::NEQ
+                        and is_index_answerable<typename Index::Key, false>(Atoms::atoms[i])) {
+                        bounds |= clause;
+                    }
+                }
+            }
+            return bounds;
+        }();
+        static constexpr bool usable = bound_atoms != 0;
+
+        static constexpr auto bounds = pick_atoms<Atoms, bound_atoms>();
+        static constexpr std::size_t num_bounds = bounds.size();
+        static constexpr auto bound_rhs_types = make_rhs_type_list_1d<num_bounds, num_bounds>(bounds);
+        using Residual = ResidualCNF<S, CNFSource, bound_atoms>;
+
+        template<std::size_t... Idx>
+        static auto candidate_range(const Index& index, std::index_sequence<Idx...>) {
+            std::size_t lo = 0, hi = index.size();
+            (..., index.template narrow<bounds[Idx].cop>(std::get<RHS<bound_rhs_types[Idx]>>(bounds[Idx].rhs), lo, hi));
+            return std::make_pair(lo, hi);
+        }
+
+        static std::generator<SchemaTuple<S>> scan(const IsIndexedTable auto& input) {
+            check_index_fresh(input.index.size(), std::ranges::size(input.table));
+            const auto [lo, hi] = candidate_range(input.index, std::make_index_sequence<num_bounds>());
+            for (std::size_t pos = lo; pos < hi; ++pos) {
+                const auto& tuple = input.table[input.index.row_id(pos)];
+                if (Residual::accepts(tuple)) {
+                    co_yield tuple;
+                }
+            }
+        }
+    };
+}
+}
+
+#endif //SQL_SORTED_INDEX_H
@@ -0,0 +1,220 @@
+#ifndef SQL_ZONE_MAP_H
+#define SQL_ZONE_MAP_H
+
+#include <cmath>
+#include <vector>
+#include <variant>
+#include "common.h"
+#include "operator/selector.h"
+#include "index/indexed_table.h"
+
+namespace ctsql {
+    // per-block synopsis of a table: the min/max of every ordered column over each run of BlockSize rows.
+    // on tables that are clustered by some column (time, id, ...) most blocks can be ruled out without touching their rows
+    template<Reflectable Schema, std::size_t BlockSize = 1024>
+    class ZoneMap {
+    public:
+        static_assert(BlockSize > 0);
+        using SchemaType = Schema;
+        using STuple = SchemaTuple<Schema>;
+        static constexpr std::size_t block_size = BlockSize;
+
+        // NaNs are left out of min/max, as they are unordered: a block that holds some can still be ruled out by the
+        // other rows, but never matches as a whole; a block of only NaNs is always scanned
+        template<typename T>
+        struct ColumnZone {
+            T min;
+            T max;
+            bool has_nan = false;
+            bool all_nan = false;
+        };
+        // columns without an ordering get no synopsis; they can never rule out a block
+        template<typename T>
+        using ColumnSynopsis = std::conditional_t<std::totally_ordered<T>, ColumnZone<T>, std::monostate>;
+
+        template<typename Tuple>
+        struct MakeZone;
+        template<typename... Ts>
+        struct MakeZone<std::tuple<Ts...>> {
+            using type = std::tuple<ColumnSynopsis<std::remove_cvref_t<Ts>>...>;
+        };
+        using Zone = typename MakeZone<STuple>::type;
+
+        ZoneMap() = default;
+        explicit ZoneMap(const std::ranges::random_access_range auto& table) { rebuild(table); }
+
+        void rebuild(const std::ranges::random_access_range auto& table) {
+            zones.clear();
+            num_rows = 0;
+            append(table);
+        }
+
+        // summarize the rows appended to the table since the last (re)build; a trailing partial block is recomputed
+        void append(const std::ranges::random_access_range auto& table) {
+            const std::size_t n = std::ranges::size(table);
+            if (num_rows % BlockSize != 0) {
+                zones.pop_back();
+                num_rows -= num_rows % BlockSize;
+            }
+            for (; num_rows < n; num_rows = std::min(num_rows + BlockSize, n)) {
+                zones.emplace_back(summarize(table, num_rows, std::min(num_rows + BlockSize, n),
+                                             std::make_index_sequence<std::tuple_size_v<STuple>>()));
+            }
+        }
+
+        [[nodiscard]] std::size_t size() const { return num_rows; }
+        [[nodiscard]] std::size_t num_blocks() const { return zones.size(); }
+        [[nodiscard]] const Zone& zone(std::size_t block) const { return zones[block]; }
+
+    private:
+        template<std::size_t Idx>
+        static auto summarize_column(const auto& table, std::size_t first, std::size_t last) {
+            using T = std::remove_cvref_t<std::tuple_element_t<Idx, STuple>>;
+            if constexpr (std::totally_ordered<T>) {
+                ColumnZone<T> cz{};
+                std::size_t i = first;
+                if constexpr (std::is_floating_point_v<T>) {
+                    for (; i < last and std::isnan(std::get<Idx>(table[i])); ++i) {
+                        cz.has_nan = true;
+                    }
+                    if (i == last) {
+                        cz.all_nan = true;
+                        return cz;
+                    }
+                }
+                cz.min = cz.max = std::get<Idx>(table[i]);
+                for (++i; i < last; ++i) {
+                    const auto& v = std::get<Idx>(table[i]);
+                    if constexpr (std::is_floating_point_v<T>) {
+                        if (std::isnan(v)) {
+                            cz.has_nan = true;
+                            continue;
+                        }
+                    }
+                    if (v < cz.min) {
+                        cz.min = v;
+                    } else if (cz.max < v) {
+                        cz.max = v;
+                    }
+                }
+                return cz;
+            } else {
+                return std::monostate{};
+            }
+        }
+
+        template<std::size_t... Idx>
+        static Zone summarize(const auto& table, std::size_t first, std::size_t last, std::index_sequence<Idx...>) {
+            return Zone{summarize_column<Idx>(table, first, last)...};
+        }
+
+        std::vector<Zone> zones;
+        std::size_t num_rows = 0;
+    };
+
+namespace impl {
+    template<typename T>
+    concept IsZoneMap = requires(const T& zm) {
+        T::block_size;
+        zm.zone(std::size_t{});
+    };
+
+    // what a [min, max] synopsis says about "column cop v": whether some row may satisfy it, and whether all rows do
+    struct ZoneVerdict {
+        bool maybe;
+        bool always;
+    };
+
+    template<CompOp cop>
+    constexpr ZoneVerdict compare_zone(const auto& lo, const auto& hi, const auto& v) {
+        if constexpr (cop == CompOp::EQ) {
+            return {not (v < lo) and not (hi < v), lo == v and hi == v};
+        } else if constexpr (cop == CompOp::NEQ) {
+            return {not (lo == v and hi == v), v < lo or hi < v};
+        } else if constexpr (cop == CompOp::GT) {
+            return {hi > v, lo > v};
+        } else if constexpr (cop == CompOp::GEQ) {
+            return {hi >= v, lo >= v};
+        } else if constexpr (cop == CompOp::LT) {
+            return {lo < v, hi < v};
+        } else {
+            static_assert(cop == CompOp::LEQ);
+            return {lo <= v, hi <= v};
+        }
+    }
+
+    template<typename ZM, size_t lhs_idx, CompOp cop, RHSTypeTag rhs_type>
+    constexpr auto make_zone_selector(const BooleanFactor<true>& bf) {
+        if constexpr (rhs_type == RHSTypeTag::PARAM) {  // nothing is known about a placeholder
+            return [](const typename ZM::Zone&) -> ZoneVerdict { return {true, false}; };
+        } else {
+            return [rhs_val = std::get<RHS<rhs_type>>(bf.rhs)](const typename ZM::Zone& zone) -> ZoneVerdict {
+                const auto& cz = std::get<lhs_idx>(zone);
+                if constexpr (std::is_same_v<std::remove_cvref_t<decltype(cz)>, std::monostate>) {
+                    return {true, false};
+                } else {
+                    if (cz.all_nan) {
+                        return {true, false};
+                    }
+                    ZoneVerdict verdict = compare_zone<cop>(cz.min, cz.max, rhs_val);
+                    if (cz.has_nan) {  // a NaN fails every comparison but <>
+                        verdict.maybe = verdict.maybe or cop == CompOp::NEQ;
+                        verdict.always = false;
+                    }
+                    return verdict;
+                }
+            };
+        }
+    }
+
+    // access path for a CNF over a base table with a zone map.
+    // the atoms of the CNF are evaluated on each block synopsis: since atoms only appear un-negated, the CNF over the
+    // "maybe" bits tells whether any row of the block can match, and over the "always" bits whether every row does
+    template<Reflectable S, typename CNFSource, typename ZM>
+    struct ZoneScan {
+        using Atoms = AtomTable<S, void, true, CNFSource::cnf, CNFSource::inner_dim>;
+        static constexpr bool usable = not CNFSource::cnf.empty();
+        static constexpr auto selector = make_cnf_selector<Atoms>();
+
+        template<std::size_t... Idx>
+        static constexpr auto make_block_evaluator(std::index_sequence<Idx...>) {
+            return [zone_selectors = std::make_tuple(make_zone_selector<ZM, Atoms::lhs_indices[Idx], Atoms::cop_list[Idx], Atoms::rhs_types[Idx]>(Atoms::atoms[Idx])...)]
+                   (const typename ZM::Zone& zone) {
+                AtomMask maybe = 0, always = 0;
+                (..., [&](ZoneVerdict verdict) {
+                    maybe |= static_cast<AtomMask>(verdict.maybe) << Idx;
+                    always |= static_cast<AtomMask>(verdict.always) << Idx;
+                }(std::get<Idx>(zone_selectors)(zone)));
+                return std::make_pair(maybe, always);
+            };
+        }
+        static constexpr auto block_evaluator = make_block_evaluator(std::make_index_sequence<Atoms::size>());
+
+        static constexpr bool satisfies(AtomMask m) {
+            return std::all_of(Atoms::masks.begin(), Atoms::masks.end(), [m](AtomMask clause){ return (m & clause) != 0; });
+        }
+
+        static std::generator<SchemaTuple<S>> scan(const IsIndexedTable auto& input) {
+            const auto& table = input.table;
+            const auto& zm = input.index;
+            check_index_fresh(zm.size(), std::ranges::size(table));
+            for (std::size_t block = 0; block < zm.num_blocks(); ++block) {
+                const auto [maybe, always] = block_evaluator(zm.zone(block));
+                if (not satisfies(maybe)) {  // no row of this block can match
+                    continue;
+                }
+                const std::size_t first = block * ZM::block_size;
+                const std::size_t last = std::min(first + ZM::block_size, zm.size());
+                const bool all_match = satisfies(always);
+                for (std::size_t i = first; i < last; ++i) {
+                    if (all_match or selector(table[i])) {
+                        co_yield table[i];
+                    }
+                }
+            }
+        }
+    };
+}
+}
+
+#endif //SQL_ZONE_MAP_H
@@ -0,0 +1,89 @@
+#ifndef SQL_BATCH_H
+#define SQL_BATCH_H
+
+#include <unordered_map>
+#include <vector>
+#include "common.h"
+#include "operator/selector.h"
+
+namespace ctsql {
+namespace impl {
+    // an atom `column = placeholder` that every DNF term contains. a row can then only satisfy the bindings whose
+    // value equals its column, so those are looked up in a hash table instead of trying every binding
+    struct RoutingKey {
+        bool usable = false;
+        std::size_t atom = 0;
+    };
+
+    template<typename Table>
+    constexpr RoutingKey find_routing_key() {
+        for (std::size_t i=0; i<Table::size; ++i) {
+            if (Table::rhs_types[i] != RHSTypeTag::PARAM or Table::cop_list[i] != CompOp::EQ) {
+                continue;
+            }
+            bool in_every_term = true;
+            for (AtomMask term: Table::masks) {
+                if (((term >> i) & 1) == 0) {
+                    in_every_term = false;
+                }
+            }
+            if (in_every_term) {
+                return {true, i};
+            }
+        }
+        return {};
+    }
+
+    // one pass over the input for many bindings of a single-table query: the literal atoms are evaluated once
+    // per row, only the placeholder atoms once per (row, candidate binding)
+    template<typename QP, typename Bound>
+    struct BatchScan {
+        using Table = typename QP::WhereAtoms;
+        using STuple = typename QP::STuple;
+        static constexpr auto literal_evaluator = make_atom_evaluator<typename QP::S1Type, void, true, Table::lhs_indices, Table::rhs_indices,
+                                                                      Table::cop_list, Table::rhs_types, Table::size, AtomSubset::LITERALS>(Table::atoms);
+        static constexpr auto param_evaluator = make_atom_evaluator<typename QP::S1Type, void, true, Table::lhs_indices, Table::rhs_indices,
+                                                                    Table::cop_list, Table::rhs_types, Table::size, AtomSubset::PARAMS>(Table::atoms);
+        static constexpr RoutingKey key = find_routing_key<Table>();
+
+        static bool satisfies(AtomMask m) {
+            return std::any_of(Table::masks.begin(), Table::masks.end(), [m](AtomMask term){ return (m & term) == term; });
+        }
+
+        static void dispatch(const auto& row, const std::vector<Bound>& bindings, const auto& candidates, auto& folds) {
+            const AtomMask literals = literal_evaluator(row);
+            for (std::size_t i: candidates) {
+                if (satisfies(literals | param_evaluator(row, bindings[i].values))) {
+                    folds[i]->push(row);
+                }
+            }
+        }
+
+        // pushes every row, in input order, to the folds (see operator/fold.h) of the bindings it matches
+        static void route(std::ranges::range auto& input, const std::vector<Bound>& bindings, auto& folds) {
+            if constexpr (key.usable) {
+                constexpr std::size_t column = Table::lhs_indices[key.atom];
+                constexpr std::size_t param = Table::rhs_indices[key.atom];
+                using Key = std::tuple_element_t<column, STuple>;
+                // the full predicate is still checked, so a lossy conversion of the bound value only costs a probe
+                std::unordered_map<Key, std::vector<std::size_t>> routes;
+                for (std::size_t i=0; i<bindings.size(); ++i) {
+                    routes[static_cast<Key>(std::get<param>(bindings[i].values))].push_back(i);
+                }
+                for (auto&& row: input) {
+                    if (auto pos = routes.find(std::get<column>(row)); pos != routes.end()) {
+                        dispatch(row, bindings, pos->second, folds);
+                    }
+                }
+            } else {
+                const auto all = std::views::iota(std::size_t{0}, bindings.size());
+                for (auto&& row: input) {
+                    dispatch(row, bindings, all, folds);
+                }
+            }
+        }
+    };
+}
+}
+
+#endif //SQL_BATCH_H
@@ -0,0 +1,33 @@
+#ifndef SQL_CLUSTERED_H
+#define SQL_CLUSTERED_H
+
+#include "common.h"
+
+namespace ctsql {
+    // an input whose caller guarantees that rows with equal GROUP BY keys are adjacent
+    // (e.g. sorted on the keys). grouping over it streams one run at a time instead of hashing every group
+    template<std::ranges::range Input>
+    struct ClusteredInput {
+        Input& input;
+        auto begin() { return std::ranges::begin(input); }
+        auto end() { return std::ranges::end(input); }
+    };
+
+    template<std::ranges::range Input>
+    constexpr auto clustered(Input& input) {
+        return ClusteredInput<Input>{input};
+    }
+
+namespace impl {
+    template<typename T>
+    struct is_clustered_input : std::false_type {};
+
+    template<typename Input>
+    struct is_clustered_input<ClusteredInput<Input>> : std::true_type {};
+
+    template<typename T>
+    concept IsClusteredInput = is_clustered_input<std::remove_cvref_t<T>>::value;
+}
+}
+
+#endif //SQL_CLUSTERED_H
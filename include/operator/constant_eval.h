@@ -0,0 +1,144 @@
+#ifndef SQL_CONSTANT_EVAL_H
+#define SQL_CONSTANT_EVAL_H
+
+#include <algorithm>
+#include <array>
+#include <tuple>
+#include "common.h"
+#include "operator/projector.h"
+
+namespace ctsql {
+namespace impl {
+    // a row that can outlive constant evaluation, as an element of a constexpr std::array: memory allocated during
+    // constant evaluation must be freed before it ends, so columns such as std::string cannot be part of a result
+    // (they still can be read from the input, or compared, while it runs). numbers, enums and std::string_view can
+    template<typename T>
+    struct is_constant_row: std::false_type {};
+
+    template<typename... Ts>
+    struct is_constant_row<std::tuple<Ts...>>: std::bool_constant<(... and std::is_trivially_destructible_v<Ts>)> {};
+
+    // a single-table query evaluated during constant evaluation, where neither coroutines nor hash tables are
+    // available: rows are filtered, grouped by linear search and sorted into fixed-capacity arrays.
+    // the input is a constexpr std::array of either schema objects or schema tuples
+    template<typename QP, const auto& input>
+    struct ConstantEval {
+        using STuple = typename QP::STuple;
+        using PTuple = typename QP::PTuple;
+        using ResultType = typename QP::ResultType;
+        static constexpr std::size_t num_rows = input.size();
+        // a global aggregate yields one row even over an empty input
+        static constexpr std::size_t capacity = std::max<std::size_t>(num_rows, 1);
+
+        static constexpr STuple row(std::size_t i) {
+            if constexpr (std::is_same_v<std::remove_cvref_t<decltype(input[i])>, STuple>) {
+                return input[i];
+            } else {
+                return schema_to_tuple(input[i]);
+            }
+        }
+
+        static constexpr bool admits(const STuple& t) {
+            if constexpr (QP::dnf_where_selector) {
+                return QP::dnf_where_selector.value()(t);
+            } else {
+                return true;
+            }
+        }
+
+        static constexpr ResultType project(const STuple& t) {
+            if constexpr (QP::projector) {
+                return QP::projector.value()(t);
+            } else {
+                return t;
+            }
+        }
+
+        // same semantics as the reducers of process: plain columns keep the first value of their group
+        template<std::size_t... Idx>
+        static constexpr void fold(PTuple& acc, const PTuple& p, bool first, std::index_sequence<Idx...>) {
+            (..., [&]() {
+                constexpr AggOp agg = QP::agg_ops[Idx];
+                if constexpr (agg == AggOp::NONE) {
+                    if (first) {
+                        std::get<Idx>(acc) = std::get<Idx>(p);
+                    }
+                } else if constexpr (agg == AggOp::COUNT or agg == AggOp::SUM) {
+                    std::get<Idx>(acc) += std::get<Idx>(p);
+                } else if constexpr (agg == AggOp::MAX) {
+                    if (std::get<Idx>(p) > std::get<Idx>(acc)) {
+                        std::get<Idx>(acc) = std::get<Idx>(p);
+                    }
+                } else {
+                    if (std::get<Idx>(p) < std::get<Idx>(acc)) {
+                        std::get<Idx>(acc) = std::get<Idx>(p);
+                    }
+                }
+            }());
+        }
+
+        static constexpr auto columns = std::make_index_sequence<std::tuple_size_v<PTuple>>();
+
+        // the results before ORDER BY/LIMIT, and how many of them there are
+        static constexpr auto collect() {
+            std::array<ResultType, capacity> out{};
+            std::size_t n = 0;
+            if constexpr (QP::need_reduce and QP::res.group_by_keys.empty()) {
+                out[0] = make_tuple_reduction_base<PTuple, QP::agg_ops>();
+                bool first = true;
+                for (std::size_t i = 0; i < num_rows; ++i) {
+                    if (const STuple t = row(i); admits(t)) {
+                        fold(out[0], QP::projector.value()(t), first, columns);
+                        first = false;
+                    }
+                }
+                n = 1;
+            } else if constexpr (QP::need_reduce) {
+                constexpr std::array group_by_indices = make_group_by_indices<typename QP::S1Type, void, QP::res.group_by_keys.size()>(QP::res);
+                constexpr auto gb_projector = make_projector<group_by_indices>();
+                std::array<ProjectedTuple<STuple, group_by_indices>, capacity> keys{};
+                for (std::size_t i = 0; i < num_rows; ++i) {
+                    const STuple t = row(i);
+                    if (not admits(t)) {
+                        continue;
+                    }
+                    const auto key = gb_projector(t);
+                    std::size_t g = 0;
+                    while (g < n and keys[g] != key) {
+                        ++g;
+                    }
+                    const bool fresh = g == n;
+                    if (fresh) {
+                        keys[n] = key;
+                        out[n++] = make_tuple_reduction_base<PTuple, QP::agg_ops>();
+                    }
+                    fold(out[g], QP::projector.value()(t), fresh, columns);
+                }
+            } else {
+                for (std::size_t i = 0; i < num_rows; ++i) {
+                    if (const STuple t = row(i); admits(t)) {
+                        out[n++] = project(t);
+                    }
+                }
+            }
+            if constexpr (QP::has_order_by) {
+                std::sort(out.begin(), out.begin() + n, QP::order_comparator);
+            }
+            if constexpr (QP::has_limit) {
+                n = std::min<std::size_t>(n, QP::res.limit.value());
+            }
+            return std::make_pair(out, n);
+        }
+
+        static constexpr auto collected = collect();
+
+        static constexpr auto result() {
+            std::array<ResultType, collected.second> out{};
+            std::copy_n(collected.first.begin(), collected.second, out.begin());
+            return out;
+        }
+    };
+}
+}
+
+#endif //SQL_CONSTANT_EVAL_H
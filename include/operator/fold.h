@@ -0,0 +1,170 @@
+#ifndef SQL_FOLD_H
+#define SQL_FOLD_H
+
+#include <__generator.hpp>
+#include <memory>
+#include <memory_resource>
+#include "common.h"
+#include "operator/memory.h"
+#include "operator/projector.h"
+#include "operator/sort.h"
+
+namespace ctsql {
+namespace impl {
+    // what a single-table query keeps of the rows a scan pushes to it, when one scan serves several queries (or
+    // bindings) at once: each row is reduced or projected as it arrives, so only what the result needs is kept
+    enum class FoldKind {
+        AGGREGATE,  // a single group
+        GROUPS,     // the groups, in a hash table that spills like a hash aggregate's
+        TOP_N,      // the best n projected rows
+        ROWS        // the projected rows, up to the LIMIT if there is one
+    };
+
+    template<typename QP>
+    constexpr FoldKind fold_kind = QP::need_reduce ? (QP::res.group_by_keys.empty() ? FoldKind::AGGREGATE : FoldKind::GROUPS)
+                                                   : (QP::has_order_by and QP::has_limit ? FoldKind::TOP_N : FoldKind::ROWS);
+
+    template<typename QP>
+    auto project_row(const auto& row) {
+        if constexpr (QP::projector) {
+            return QP::projector.value()(row);
+        } else {
+            return typename QP::STuple(row);
+        }
+    }
+
+    // rows() gives the folded rows, ordered and limited if complete
+    template<typename QP, FoldKind kind>
+    class Fold;
+
+    template<typename QP>
+    class Fold<QP, FoldKind::AGGREGATE> {
+    public:
+        static constexpr bool complete = false;
+        using PTuple = typename QP::PTuple;
+
+        explicit Fold(OperatorMemory&) {}
+
+        void push(const auto& row) {
+            reduce_op(acc, QP::projector.value()(row));
+        }
+
+        std::generator<PTuple> rows() {
+            co_yield acc;
+        }
+
+    private:
+        PTuple acc = make_tuple_reduction_base<PTuple, QP::agg_ops>();
+        decltype(to_tuple_operator<QP::agg_ops>()) reduce_op = to_tuple_operator<QP::agg_ops>();
+    };
+
+    template<typename QP>
+    class Fold<QP, FoldKind::GROUPS> {
+    public:
+        static constexpr bool complete = false;
+        using RG = typename QP::Reduce::RG;
+
+        explicit Fold(OperatorMemory& memory): groups(memory, 0) {}
+
+        void push(const auto& row) {
+            groups.add(RG::gb_projector(row), RG::projector(row));
+        }
+
+        std::generator<typename QP::PTuple> rows() {
+            return groups.results();
+        }
+
+    private:
+        typename RG::GroupTable groups;
+    };
+
+    template<typename QP>
+    class Fold<QP, FoldKind::TOP_N> {
+    public:
+        static constexpr bool complete = true;
+        using ResultType = typename QP::ResultType;
+
+        explicit Fold(OperatorMemory& memory): heap(QP::res.limit.value(), &memory) {}
+
+        void push(const auto& row) {
+            heap.push(project_row<QP>(row));
+        }
+
+        std::generator<ResultType> rows() {
+            for (auto& t: heap.sorted()) {
+                co_yield std::move(t);
+            }
+        }
+
+    private:
+        TopN<ResultType, QP::order_comparator> heap;
+    };
+
+    template<typename QP>
+    class Fold<QP, FoldKind::ROWS> {
+    public:
+        static constexpr bool complete = true;
+        using ResultType = typename QP::ResultType;
+
+        explicit Fold(OperatorMemory& memory): kept(&memory) {}
+
+        void push(const auto& row) {
+            if constexpr (QP::has_limit) {  // and no ORDER BY
+                if (kept.size() == QP::res.limit.value()) {
+                    return;
+                }
+            }
+            kept.emplace_back(project_row<QP>(row));
+        }
+
+        std::generator<ResultType> rows() {
+            if constexpr (QP::has_order_by) {
+                sort_rows<ResultType, QP::order_indices_and_desc.first, QP::order_indices_and_desc.second>(kept);
+            }
+            for (auto& t: kept) {
+                co_yield std::move(t);
+            }
+        }
+
+    private:
+        std::pmr::vector<ResultType> kept;
+    };
+
+    // the rows of one query pushed by a shared or batch scan. all the folds of one call charge the same query memory
+    // (see operator/memory.h), which covers them and the ORDER BY / LIMIT applied to them afterwards
+    template<typename QP>
+    class QueryFold {
+    public:
+        using ResultType = typename QP::ResultType;
+
+        explicit QueryFold(std::shared_ptr<QueryMemory> query)
+            : query{std::move(query)},
+              memory{QP::template reduce_project_name<false>, this->query},
+              fold{memory} {}
+        QueryFold(const QueryFold&) = delete;
+        QueryFold& operator=(const QueryFold&) = delete;
+
+        void push(const auto& row) {
+            fold.push(row);
+        }
+
+        // the result of the query over the rows pushed so far; the fold lives as long as the stream
+        static std::generator<ResultType> results(std::unique_ptr<QueryFold> self) {
+            using F = Fold<QP, fold_kind<QP>>;
+            if constexpr (F::complete or not (QP::has_order_by or QP::has_limit)) {
+                co_yield std::ranges::elements_of(self->fold.rows());
+            } else {
+                auto rows = self->fold.rows();
+                co_yield std::ranges::elements_of(metered<ResultType>(self->query, QP::order_limit(rows)));
+            }
+        }
+
+    private:
+        std::shared_ptr<QueryMemory> query;
+        OperatorMemory memory;
+        Fold<QP, fold_kind<QP>> fold;
+    };
+}
+}
+
+#endif //SQL_FOLD_H
@@ -0,0 +1,218 @@
+#ifndef SQL_MEMORY_H
+#define SQL_MEMORY_H
+
+#include <__generator.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "profile/instrument.h"
+
+// accounting of the memory held by operators that keep rows: the hash tables of hash joins and hash aggregates, the
+// materialized side of nested loop joins, and the rows of ORDER BY (all of them, or the best n under a LIMIT).
+// their containers allocate from an OperatorMemory, which charges each byte to the operator and to the query it
+// belongs to. a query that would hold more than its budget fails with MemoryBudgetExceeded at the allocation that
+// would cross it, before the memory is taken, unless the operator catches it to spill to disk instead
+// (operator/spill.h), as hash joins and hash aggregates do.
+//
+//   ctsql::set_memory_budget(512 << 20);  // for the queries started from now on
+//   for (auto&& row: process<QP>(input)) { ... }
+//   ctsql::last_query_memory().peak;
+//
+// only the containers are counted; storage that rows allocate themselves (e.g. long strings) is not. neither are:
+//  - the scratch space of sorting (radix sort keys, chunk merges), which the sort workers allocate on their own threads
+//  - the state of window aggregates (operator/window.h), which only covers the windows still open
+//  - materialized views (view/), which are kept between queries rather than by one
+
+namespace ctsql {
+    struct MemoryUsage {
+        std::size_t current = 0;
+        std::size_t peak = 0;
+        std::size_t spilled = 0;  // bytes written to disk by operators that did not fit, see operator/spill.h
+
+        void add(std::size_t n) {
+            current += n;
+            peak = std::max(peak, current);
+        }
+        void remove(std::size_t n) {
+            current -= n;
+        }
+    };
+
+    class MemoryBudgetExceeded: public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+namespace impl {
+    inline std::atomic<std::size_t> memory_budget{0};  // bytes per query; 0 for no limit
+
+    // the memory held by the operators of one query, which runs on one thread at a time
+    class QueryMemory {
+    public:
+        QueryMemory(std::string_view sql, std::size_t budget): sql{sql}, budget{budget} {}
+
+        // whether n more bytes stay within the budget
+        bool fits(std::size_t n) const {
+            return budget == 0 or n <= budget - std::min(budget, used.current);
+        }
+
+        void charge(std::size_t n, std::string_view op) {
+            if (not fits(n)) {
+                std::string what = "memory budget of " + std::to_string(budget) + " bytes exceeded by " + std::string(op)
+                                   + ": " + std::to_string(used.current) + " bytes in use, " + std::to_string(n) + " more requested";
+                if (not sql.empty()) {
+                    what += ", in query: " + std::string(sql);
+                }
+                throw MemoryBudgetExceeded(what);
+            }
+            used.add(n);
+        }
+
+        void release(std::size_t n) {
+            used.remove(n);
+        }
+
+        void spill(std::size_t n) {
+            used.spilled += n;
+        }
+
+        MemoryUsage usage() const { return used; }
+
+    private:
+        std::string_view sql;
+        std::size_t budget;
+        MemoryUsage used;
+    };
+
+    inline thread_local std::shared_ptr<QueryMemory> current_query;  // of the query being pulled on this thread
+    inline thread_local std::shared_ptr<const QueryMemory> last_query;
+
+    class QueryScope {
+    public:
+        explicit QueryScope(std::shared_ptr<QueryMemory> memory): previous{std::move(current_query)} {
+            current_query = std::move(memory);
+        }
+        ~QueryScope() {
+            current_query = std::move(previous);
+        }
+        QueryScope(const QueryScope&) = delete;
+        QueryScope& operator=(const QueryScope&) = delete;
+
+    private:
+        std::shared_ptr<QueryMemory> previous;
+    };
+
+    // the allocations of one operator. it joins the query being pulled when it is created, or else is a query of its
+    // own, under the same budget
+    class OperatorMemory: public std::pmr::memory_resource {
+    public:
+        explicit OperatorMemory(std::string_view name)
+            : OperatorMemory(name, current_query ? current_query : std::make_shared<QueryMemory>("", memory_budget.load(std::memory_order_relaxed))) {}
+        OperatorMemory(std::string_view name, std::shared_ptr<QueryMemory> query)
+            : name{name}, query{std::move(query)}, node{instrumented ? current_node : nullptr} {}
+        OperatorMemory(const OperatorMemory&) = delete;
+        OperatorMemory& operator=(const OperatorMemory&) = delete;
+
+        // whether n more bytes stay within the budget of the query
+        bool fits(std::size_t n) const { return query->fits(n); }
+
+        MemoryUsage usage() const { return used; }
+
+        void spill(std::size_t n) {
+            used.spilled += n;
+            query->spill(n);
+            if (node) {
+                node->spilled_bytes += n;
+            }
+        }
+
+    private:
+        std::string_view name;
+        std::shared_ptr<QueryMemory> query;  // outlives the query's own stream if the operator does
+        PlanNode* node;
+        MemoryUsage used;
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            query->charge(bytes, name);
+            void* p;
+            try {
+                p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+            } catch (...) {
+                query->release(bytes);
+                throw;
+            }
+            used.add(bytes);
+            if (node) {
+                node->peak_memory = used.peak;
+            }
+            return p;
+        }
+
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+            used.remove(bytes);
+            query->release(bytes);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    // forwards the rows of input, which are pulled with the query's memory current, so that the operators under it
+    // charge it. they join it when they start, which for all of them is the first pull
+    template<typename T>
+    std::generator<T> metered(std::shared_ptr<QueryMemory> memory, std::ranges::range auto input) {
+        last_query = memory;
+        auto it = [&]() {
+            QueryScope scope(memory);
+            return std::ranges::begin(input);
+        }();
+        while (it != std::ranges::end(input)) {
+            co_yield *it;
+            QueryScope scope(memory);
+            ++it;
+        }
+    }
+
+    template<typename T>
+    std::generator<T> metered(std::string_view sql, std::ranges::range auto input) {
+        return metered<T>(std::make_shared<QueryMemory>(sql, memory_budget.load(std::memory_order_relaxed)), std::move(input));
+    }
+
+    // a query without operators that hold rows is returned as is, and costs nothing
+    template<bool holds_rows>
+    auto account_memory(std::string_view sql, std::ranges::range auto&& rows) {
+        using Rows = std::remove_cvref_t<decltype(rows)>;
+        if constexpr (holds_rows) {
+            return metered<std::ranges::range_value_t<Rows>>(sql, std::move(rows));
+        } else {
+            return Rows(std::move(rows));
+        }
+    }
+}
+
+    // the most bytes the operators of a query may hold at once; queries started afterwards that would go over it
+    // fail with MemoryBudgetExceeded. 0 (the default) is no limit. a process_batch or process_many call is one query:
+    // all its bindings or queries share the budget
+    inline void set_memory_budget(std::size_t bytes) {
+        impl::memory_budget.store(bytes, std::memory_order_relaxed);
+    }
+
+    inline std::size_t memory_budget() {
+        return impl::memory_budget.load(std::memory_order_relaxed);
+    }
+
+    // the memory of the most recently started query on this thread that holds rows (for process_batch and process_many,
+    // of the whole call); current is 0 once it is done
+    inline MemoryUsage last_query_memory() {
+        return impl::last_query ? impl::last_query->usage() : MemoryUsage{};
+    }
+}
+
+#endif //SQL_MEMORY_H
@@ -22,6 +22,15 @@ namespace ctsql::impl
         return std::make_pair(indices, agg_ops);
     }
 
+    template<Reflectable S1, Reflectable S2, std::size_t N>
+    constexpr auto make_group_by_indices(const Query& query) {
+        std::array<std::size_t, N> gb_indices{};
+        for (size_t i = 0; i < N; ++i) {
+            gb_indices[i] = get_index<S1, S2>(query.group_by_keys[i]);
+        }
+        return gb_indices;
+    }
+
     template<std::array agg_ops>
     static constexpr bool need_reduction = not std::all_of(agg_ops.begin(), agg_ops.end(), [](const auto& agg){ return agg == AggOp::NONE; });
 
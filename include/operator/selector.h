@@ -4,6 +4,7 @@
 #include "common.h"
 #include <variant>
 #include <tuple>
+#include <limits>
 
 namespace ctsql
 {
@@ -17,22 +18,14 @@ namespace impl {
             } else {
                 if constexpr (ColumnReference<decltype(bfs[i].rhs)>) {
                     indices[i] = get_index<S1, S2>(bfs[i].rhs);
+                } else if (std::holds_alternative<Param>(bfs[i].rhs)) {  // position in the bind tuple
+                    indices[i] = std::get<Param>(bfs[i].rhs).index;
                 }
             }
         }
         return indices;
     }
 
-    template<Reflectable S1, Reflectable S2, bool is_lhs, bool one_side, std::array Lens, std::size_t Cap, std::size_t... Idx>
-    constexpr auto make_indices_2d_impl(const std::array<std::array<BooleanFactor<one_side>, Cap>, Lens.size()>& cnf, std::index_sequence<Idx...>) {
-        return refl::util::to_array<std::array<std::size_t, Cap>>(std::make_tuple(make_indices_1d<S1, S2, is_lhs, Cap, Lens[Idx]>(cnf[Idx])...));
-    }
-
-    template<Reflectable S1, Reflectable S2, bool is_lhs, bool one_side, std::array Lens, std::size_t Cap>
-    constexpr auto make_indices_2d(const std::array<std::array<BooleanFactor<one_side>, Cap>, Lens.size()>& cnf) {
-        return make_indices_2d_impl<S1, S2, is_lhs, one_side, Lens, Cap>(cnf, std::make_index_sequence<Lens.size()>());
-    }
-
     template<std::size_t Cap, std::size_t Len, typename Vec>
     constexpr auto make_cop_list_1d(const Vec& bfs) {
         std::array<CompOp, Cap> cops{};
@@ -42,16 +35,6 @@ namespace impl {
         return cops;
     }
 
-    template<std::array Lens, std::size_t Cap, bool one_side, std::size_t... Idx>
-    constexpr auto make_cop_list_2d_impl(const std::array<std::array<BooleanFactor<one_side>, Cap>, Lens.size()>& cnf, std::index_sequence<Idx...>) {
-        return refl::util::to_array<std::array<CompOp, Cap>>(std::make_tuple(make_cop_list_1d<Cap, Lens[Idx]>(cnf[Idx])...));
-    }
-
-    template<std::array Lens, std::size_t Cap, bool one_side>
-    constexpr auto make_cop_list_2d(const std::array<std::array<BooleanFactor<one_side>, Cap>, Lens.size()>& cnf) {
-        return make_cop_list_2d_impl<Lens, Cap, one_side>(cnf, std::make_index_sequence<Lens.size()>());
-    }
-
     template<std::size_t Cap, std::size_t Len, typename Vec>
     constexpr auto make_rhs_type_list_1d(const Vec& bfs) {
         std::array<RHSTypeTag, Cap> rhs_types{};
@@ -63,6 +46,8 @@ namespace impl {
                     rhs_types[i] = RHSTypeTag::INT;
                 } else if (std::holds_alternative<double>(bfs[i].rhs)) {
                     rhs_types[i] = RHSTypeTag::DOUBLE;
+                } else if (std::holds_alternative<Param>(bfs[i].rhs)) {
+                    rhs_types[i] = RHSTypeTag::PARAM;
                 } else {
                     rhs_types[i] = RHSTypeTag::STRING;
                 }
@@ -71,39 +56,38 @@ namespace impl {
         return rhs_types;
     }
 
-    template<std::array Lens, std::size_t Cap, bool one_side, std::size_t... Idx>
-    constexpr auto make_rhs_type_list_2d_impl(const std::array<std::array<BooleanFactor<one_side>, Cap>, Lens.size()>& cnf, std::index_sequence<Idx...>) {
-        return refl::util::to_array<std::array<RHSTypeTag, Cap>>(std::make_tuple(make_rhs_type_list_1d<Cap, Lens[Idx]>(cnf[Idx])...));
-    }
-
-    template<std::array Lens, std::size_t Cap, bool one_side>
-    constexpr auto make_rhs_type_list_2d(const std::array<std::array<BooleanFactor<one_side>, Cap>, Lens.size()>& cnf) {
-        return make_rhs_type_list_2d_impl<Lens, Cap, one_side>(cnf, std::make_index_sequence<Lens.size()>());
-    }
-
     template<RHSTypeTag rhs_type>
     using RHS = std::conditional_t<rhs_type==RHSTypeTag::INT, int64_t, std::conditional_t<rhs_type==RHSTypeTag::DOUBLE, double, std::string_view>>;
 
+    // selectors take the tuple and, for prepared queries, the tuple of placeholder values;
+    // a literal is captured at compile time, a placeholder (rhs_type PARAM) is read from position rhs_idx of the bind tuple
     template<Reflectable S1, Reflectable S2, bool one_side, size_t lhs_idx, size_t rhs_idx, CompOp cop, RHSTypeTag rhs_type>
     constexpr auto make_selector(const BooleanFactor<one_side>& bf) {
         constexpr auto comp_f = to_operator<cop>();
         if constexpr (one_side) {
-            if constexpr (std::is_void_v<S2>) {
-                return [comp_f, rhs_val = std::get<RHS<rhs_type>>(bf.rhs)](const SchemaTuple<S1>& s) -> bool {
-                    return comp_f(std::get<lhs_idx>(s), rhs_val);
+            constexpr auto select = [comp_f](const auto& s, const auto& rhs_val) -> bool {
+                return comp_f(std::get<lhs_idx>(s), rhs_val);
+            };
+            if constexpr (rhs_type == RHSTypeTag::PARAM) {
+                return [select](const auto& s, const auto&... params) -> bool {
+                    static_assert(sizeof...(params) == 1, "the query has placeholders; pass their values with bind_params");
+                    return select(s, std::get<rhs_idx>(params...));
+                };
+            } else if constexpr (std::is_void_v<S2>) {
+                return [select, rhs_val = std::get<RHS<rhs_type>>(bf.rhs)](const SchemaTuple<S1>& s, const auto&...) -> bool {
+                    return select(s, rhs_val);
                 };
             } else {
-                return [comp_f, rhs_val = std::get<RHS<rhs_type>>(bf.rhs)](const SchemaTuple2<S1, S2>& s) -> bool {
-                    return comp_f(std::get<lhs_idx>(s), rhs_val);
+                return [select, rhs_val = std::get<RHS<rhs_type>>(bf.rhs)](const SchemaTuple2<S1, S2>& s, const auto&...) -> bool {
+                    return select(s, rhs_val);
                 };
             }
         } else {
             static_assert(not std::is_void_v<S2>);
-            return [comp_f](const SchemaTuple2<S1, S2>& s) -> bool {
+            return [comp_f](const SchemaTuple2<S1, S2>& s, const auto&...) -> bool {
                 return comp_f(std::get<lhs_idx>(s), std::get<rhs_idx>(s));
             };
         }
-
     }
 
     template<typename... Selectors>
@@ -127,27 +111,6 @@ namespace impl {
         return [](const auto& tuple) { return true; };
     }
 
-    template<typename... Selectors>
-    [[maybe_unused]] constexpr auto or_construct(Selectors... selector);
-
-    template<typename Selector, typename... Selectors>
-    constexpr auto or_construct(Selector s, Selectors... selectors) {
-        const auto rec = or_construct(selectors...);
-        return [s, rec](const auto& tuple){ return s(tuple) or rec(tuple); };
-    }
-
-    // actual base case
-    template<typename Selector>
-    constexpr auto or_construct(Selector s) {
-        return [s](const auto& tuple){ return s(tuple); };
-    }
-
-    // no filter -> true value always; special case
-    template<>
-    constexpr auto or_construct() {
-        return [](const auto& tuple) { return true; };
-    }
-
     // compute length of nested array
     template<std::size_t Len>
     constexpr std::array<std::size_t, Len> make_inner_dim(std::size_t v) {
@@ -187,15 +150,6 @@ namespace impl {
         return aligned;
     }
 
-    template<Reflectable S1, Reflectable S2, bool one_side, std::array lhs_indices, std::array rhs_indices, std::array cop_list, std::array rhs_types, typename Vec, std::size_t... Idx>
-    constexpr auto make_selector_or_cons_impl(const Vec& bfs, std::index_sequence<Idx...>) {
-        return or_construct(make_selector<S1, S2, one_side, lhs_indices[Idx], rhs_indices[Idx], cop_list[Idx], rhs_types[Idx]>(bfs[Idx])...);
-    }
-    template<Reflectable S1, Reflectable S2, bool one_side, std::array lhs_indices, std::array rhs_indices, std::array cop_list, std::array rhs_types, std::size_t Len, typename Vec>
-    constexpr auto make_selector_or_cons(const Vec& bfs) {
-        return make_selector_or_cons_impl<S1, S2, one_side, lhs_indices, rhs_indices, cop_list, rhs_types>(bfs, std::make_index_sequence<Len>());
-    }
-
     template<Reflectable S1, Reflectable S2, bool one_side, std::array lhs_indices, std::array rhs_indices, std::array cop_list, std::array rhs_types, typename Vec, std::size_t... Idx>
     constexpr auto make_selector_and_cons_impl(const Vec& bfs, std::index_sequence<Idx...>) {
         return and_construct(make_selector<S1, S2, one_side, lhs_indices[Idx], rhs_indices[Idx], cop_list[Idx], rhs_types[Idx]>(bfs[Idx])...);
@@ -205,28 +159,222 @@ namespace impl {
         return make_selector_and_cons_impl<S1, S2, one_side, lhs_indices, rhs_indices, cop_list, rhs_types>(bfs, std::make_index_sequence<Len>());
     }
 
-    template<Reflectable S1, Reflectable S2,
-            bool one_side, std::array lhs_indices, std::array rhs_indices, std::array cop_list, std::array rhs_types, std::array Lens, typename Mat, std::size_t... Idx>
-    constexpr auto make_cnf_selector_impl(const Mat& cnf, std::index_sequence<Idx...>) {
-        return and_construct(make_selector_or_cons<S1, S2, one_side, lhs_indices[Idx], rhs_indices[Idx], cop_list[Idx], rhs_types[Idx], Lens[Idx]>(cnf[Idx])...);
+    // common-subexpression elimination on atomic predicates:
+    // after DNF -> CNF the same boolean factor shows up in many clauses. instead of one comparison per occurrence,
+    // every distinct atom is evaluated once per tuple into a bitmask; clauses (CNF) or terms (DNF) are masks over it
+    using AtomMask = uint64_t;
+    static_assert(MaxAndTerms * MaxOrTerms <= std::numeric_limits<AtomMask>::digits, "too many atoms to fit in a mask");
+
+    template<bool one_side>
+    using AtomList = ctpg::stdex::cvector<BooleanFactor<one_side>, MaxAndTerms * MaxOrTerms>;
+
+    template<bool one_side>
+    constexpr bool same_atom(const BooleanFactor<one_side>& a, const BooleanFactor<one_side>& b) {
+        if (a.cop != b.cop or a.lhs.table_name != b.lhs.table_name or a.lhs.column_name != b.lhs.column_name) {
+            return false;
+        }
+        if constexpr (one_side) {
+            return a.rhs == b.rhs;
+        } else {
+            return a.rhs.table_name == b.rhs.table_name and a.rhs.column_name == b.rhs.column_name;
+        }
     }
 
-    template<Reflectable S1, Reflectable S2,
-            bool one_side, std::array lhs_indices, std::array rhs_indices, std::array cop_list, std::array rhs_types, std::array Lens, typename Mat>
-    constexpr auto make_cnf_selector(const Mat& cnf) {
-        return make_cnf_selector_impl<S1, S2, one_side, lhs_indices, rhs_indices, cop_list, rhs_types, Lens>(cnf, std::make_index_sequence<Lens.size()>());
+    template<bool one_side, typename List>
+    constexpr std::size_t find_atom(const List& atoms, const BooleanFactor<one_side>& bf) {
+        for (std::size_t i = 0; i < atoms.size(); ++i) {
+            if (same_atom(atoms[i], bf)) {
+                return i;
+            }
+        }
+        return atoms.size();
     }
 
-    template<Reflectable S1, Reflectable S2,
-            bool one_side, std::array lhs_indices, std::array rhs_indices, std::array cop_list, std::array rhs_types, std::array Lens, typename Mat, std::size_t... Idx>
-    constexpr auto make_dnf_selector_impl(const Mat& cnf, std::index_sequence<Idx...>) {
-        return or_construct(make_selector_and_cons<S1, S2, one_side, lhs_indices[Idx], rhs_indices[Idx], cop_list[Idx], rhs_types[Idx], Lens[Idx]>(cnf[Idx])...);
+    // distinct atoms of a (possibly ragged) matrix of boolean factors, in order of first appearance
+    template<bool one_side, std::size_t M, typename Mat>
+    constexpr auto collect_atoms(const Mat& mat, const std::array<std::size_t, M>& lens) {
+        AtomList<one_side> atoms;
+        for (std::size_t i = 0; i < M; ++i) {
+            for (std::size_t j = 0; j < lens[i]; ++j) {
+                if (find_atom(atoms, mat[i][j]) == atoms.size()) {
+                    atoms.push_back(mat[i][j]);
+                }
+            }
+        }
+        return atoms;
+    }
+
+    // each row of the matrix as the set of atoms it refers to
+    template<bool one_side, std::size_t M, typename Mat>
+    constexpr auto make_clause_masks(const Mat& mat, const std::array<std::size_t, M>& lens, const AtomList<one_side>& atoms) {
+        std::array<AtomMask, M> masks{};
+        for (std::size_t i = 0; i < M; ++i) {
+            for (std::size_t j = 0; j < lens[i]; ++j) {
+                masks[i] |= AtomMask{1} << find_atom(atoms, mat[i][j]);
+            }
+        }
+        return masks;
+    }
+
+    // a row is redundant if another row refers to a subset of its atoms:
+    //  - CNF: (a OR b) is implied by (a); DNF: (a AND b) implies (a)
+    // of identical rows, only the first one is kept
+    template<std::size_t M>
+    constexpr bool is_redundant_clause(const std::array<AtomMask, M>& masks, std::size_t i) {
+        for (std::size_t j = 0; j < M; ++j) {
+            if (j != i and (masks[j] & ~masks[i]) == 0 and (masks[j] != masks[i] or j < i)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template<std::size_t M>
+    constexpr std::size_t count_essential_clauses(const std::array<AtomMask, M>& masks) {
+        std::size_t cnt = 0;
+        for (std::size_t i = 0; i < M; ++i) {
+            cnt += not is_redundant_clause(masks, i);
+        }
+        return cnt;
+    }
+
+    template<std::size_t K, std::size_t M>
+    constexpr auto prune_clauses(const std::array<AtomMask, M>& masks) {
+        std::array<AtomMask, K> pruned{};
+        std::size_t k = 0;
+        for (std::size_t i = 0; i < M; ++i) {
+            if (not is_redundant_clause(masks, i)) {
+                pruned[k++] = masks[i];
+            }
+        }
+        return pruned;
+    }
+
+    // which atoms an evaluator covers; running one query under many bindings computes the literal part once per tuple
+    enum class AtomSubset {
+        ALL=0, LITERALS, PARAMS
+    };
+
+    template<AtomSubset subset, RHSTypeTag rhs_type>
+    constexpr bool in_subset = subset == AtomSubset::ALL or ((rhs_type == RHSTypeTag::PARAM) == (subset == AtomSubset::PARAMS));
+
+    template<AtomSubset subset, RHSTypeTag rhs_type, std::size_t Idx>
+    constexpr AtomMask eval_atom(const auto& selector, const auto& tuple, const auto&... params) {
+        if constexpr (in_subset<subset, rhs_type>) {
+            return static_cast<AtomMask>(selector(tuple, params...)) << Idx;
+        } else {
+            return 0;
+        }
+    }
+
+    // evaluates every atom (of the subset) exactly once; bit i of the result holds the value of atom i
+    template<Reflectable S1, Reflectable S2, bool one_side, std::array lhs_indices, std::array rhs_indices, std::array cop_list, std::array rhs_types, AtomSubset subset, typename Vec, std::size_t... Idx>
+    constexpr auto make_atom_evaluator_impl(const Vec& atoms, std::index_sequence<Idx...>) {
+        return [selectors = std::make_tuple(make_selector<S1, S2, one_side, lhs_indices[Idx], rhs_indices[Idx], cop_list[Idx], rhs_types[Idx]>(atoms[Idx])...)](const auto& tuple, const auto&... params) {
+            return (AtomMask{0} | ... | eval_atom<subset, rhs_types[Idx], Idx>(std::get<Idx>(selectors), tuple, params...));
+        };
+    }
+
+    template<Reflectable S1, Reflectable S2, bool one_side, std::array lhs_indices, std::array rhs_indices, std::array cop_list, std::array rhs_types, std::size_t Len, AtomSubset subset=AtomSubset::ALL, typename Vec>
+    constexpr auto make_atom_evaluator(const Vec& atoms) {
+        return make_atom_evaluator_impl<S1, S2, one_side, lhs_indices, rhs_indices, cop_list, rhs_types, subset>(atoms, std::make_index_sequence<Len>());
+    }
+
+    template<Reflectable S1, Reflectable S2, bool one_side, std::array lhs_indices, std::array rhs_indices, std::array cop_list, std::array rhs_types, typename Vec, std::size_t... Idx>
+    constexpr auto make_atom_selectors(const Vec& atoms, std::index_sequence<Idx...>) {
+        return std::make_tuple(make_selector<S1, S2, one_side, lhs_indices[Idx], rhs_indices[Idx], cop_list[Idx], rhs_types[Idx]>(atoms[Idx])...);
+    }
+
+    // whether any atom of a CNF/DNF matrix compares against a placeholder
+    template<typename Mat>
+    constexpr bool has_params(const Mat& mat) {
+        for (const auto& row: mat) {
+            for (const auto& bf: row) {
+                if constexpr (not ColumnReference<decltype(bf.rhs)>) {
+                    if (std::holds_alternative<Param>(bf.rhs)) {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    // the atoms that more than one clause (or term) refers to
+    template<std::size_t M>
+    constexpr AtomMask shared_atoms(const std::array<AtomMask, M>& masks) {
+        AtomMask seen = 0, shared = 0;
+        for (AtomMask m: masks) {
+            shared |= seen & m;
+            seen |= m;
+        }
+        return shared;
+    }
+
+    // the distinct atoms of a CNF/DNF matrix, together with the (pruned) row masks over them
+    template<Reflectable S1, Reflectable S2, bool one_side, const auto& mat, std::array lens>
+    struct AtomTable {
+        static constexpr auto atoms = collect_atoms<one_side>(mat, lens);
+        static constexpr std::size_t size = atoms.size();
+        static constexpr auto lhs_indices = make_indices_1d<S1, S2, true, size, size>(atoms);
+        static constexpr auto rhs_indices = make_indices_1d<S1, S2, false, size, size>(atoms);  // only meaningful for two-side atoms
+        static constexpr auto cop_list = make_cop_list_1d<size, size>(atoms);
+        static constexpr auto rhs_types = make_rhs_type_list_1d<size, size>(atoms);
+        static constexpr auto selectors = make_atom_selectors<S1, S2, one_side, lhs_indices, rhs_indices, cop_list, rhs_types>(atoms, std::make_index_sequence<size>());
+
+        static constexpr auto raw_masks = make_clause_masks<one_side>(mat, lens, atoms);
+        static constexpr auto masks = prune_clauses<count_essential_clauses(raw_masks)>(raw_masks);
+        static constexpr AtomMask shared = shared_atoms(masks);
+
+        // the atoms of mask, each evaluated; bit i of the result holds the value of atom i
+        template<AtomMask mask>
+        static constexpr AtomMask evaluate(const auto& tuple, const auto&... params) {
+            return [&]<std::size_t... Idx>(std::index_sequence<Idx...>) {
+                return (AtomMask{0} | ... | (static_cast<AtomMask>(((mask >> Idx) & 1) and std::get<Idx>(selectors)(tuple, params...)) << Idx));
+            }(std::make_index_sequence<size>());
+        }
+
+        // whether some atom of mask holds, evaluated in order up to the first that does
+        template<AtomMask mask>
+        static constexpr bool any(const auto& tuple, const auto&... params) {
+            return [&]<std::size_t... Idx>(std::index_sequence<Idx...>) {
+                return (false or ... or (((mask >> Idx) & 1) and std::get<Idx>(selectors)(tuple, params...)));
+            }(std::make_index_sequence<size>());
+        }
+
+        // whether every atom of mask holds, evaluated in order up to the first that does not
+        template<AtomMask mask>
+        static constexpr bool all(const auto& tuple, const auto&... params) {
+            return [&]<std::size_t... Idx>(std::index_sequence<Idx...>) {
+                return (true and ... and (not ((mask >> Idx) & 1) or std::get<Idx>(selectors)(tuple, params...)));
+            }(std::make_index_sequence<size>());
+        }
+    };
+
+    // the selectors below evaluate the atoms that several clauses share once, up front; the others only when their
+    // clause is reached, as a chain of ORs and ANDs would, so that the first failing clause ends the evaluation
+
+    // all of the OR clauses must have at least one atom set
+    template<typename Table>
+    constexpr auto make_cnf_selector() {
+        return [](const auto& tuple, const auto&... params) {
+            const AtomMask m = Table::template evaluate<Table::shared>(tuple, params...);
+            return [&]<std::size_t... C>(std::index_sequence<C...>) {
+                return (true and ... and ((m & Table::masks[C]) != 0 or Table::template any<Table::masks[C] & ~Table::shared>(tuple, params...)));
+            }(std::make_index_sequence<Table::masks.size()>());
+        };
     }
 
-    template<Reflectable S1, Reflectable S2,
-            bool one_side, std::array lhs_indices, std::array rhs_indices, std::array cop_list, std::array rhs_types, std::array Lens, typename Mat>
-    constexpr auto make_dnf_selector(const Mat& cnf) {
-        return make_dnf_selector_impl<S1, S2, one_side, lhs_indices, rhs_indices, cop_list, rhs_types, Lens>(cnf, std::make_index_sequence<Lens.size()>());
+    // one of the AND terms must have all of its atoms set
+    template<typename Table>
+    constexpr auto make_dnf_selector() {
+        return [](const auto& tuple, const auto&... params) {
+            const AtomMask m = Table::template evaluate<Table::shared>(tuple, params...);
+            return [&]<std::size_t... C>(std::index_sequence<C...>) {
+                return (false or ... or ((m & Table::masks[C] & Table::shared) == (Table::masks[C] & Table::shared)
+                                         and Table::template all<Table::masks[C] & ~Table::shared>(tuple, params...)));
+            }(std::make_index_sequence<Table::masks.size()>());
+        };
     }
 
     // split a CNF matrix into (1) only table 1 (2) only table 2 (3) both
@@ -0,0 +1,114 @@
+#ifndef SQL_SHARED_SCAN_H
+#define SQL_SHARED_SCAN_H
+
+#include <vector>
+#include "common.h"
+#include "operator/selector.h"
+
+namespace ctsql {
+namespace impl {
+    // one pass over a table for several single-table queries. the WHERE atoms of all the queries are merged,
+    // so an atom that several queries share is evaluated once per row; each query keeps its DNF terms as
+    // masks over the merged atoms, which may span more than one word
+    template<typename... QPs>
+    struct SharedScan {
+        using S = typename std::tuple_element_t<0, std::tuple<QPs...>>::S1Type;
+        static_assert((... and std::is_same_v<typename QPs::S1Type, S>), "shared scans need all of the queries to read the same table");
+        static_assert((... and std::is_void_v<typename QPs::S2Type>), "shared scans only apply to single-table queries");
+        static_assert((... and (QPs::num_params == 0)), "shared scans do not take placeholders; bind them with process_batch");
+        using STuple = SchemaTuple<S>;
+
+        static constexpr std::size_t capacity = std::max<std::size_t>(1, (... + QPs::WhereAtoms::size));
+
+        template<typename Table>
+        static constexpr void merge_atoms(ctpg::stdex::cvector<BooleanFactor<true>, capacity>& merged) {
+            for (std::size_t i=0; i<Table::size; ++i) {
+                if (find_atom(merged, Table::atoms[i]) == merged.size()) {
+                    merged.push_back(Table::atoms[i]);
+                }
+            }
+        }
+
+        static constexpr auto atoms = [](){
+            ctpg::stdex::cvector<BooleanFactor<true>, capacity> merged;
+            (..., merge_atoms<typename QPs::WhereAtoms>(merged));
+            return merged;
+        }();
+        static constexpr std::size_t size = atoms.size();
+        static constexpr std::size_t words = (size + std::numeric_limits<AtomMask>::digits - 1) / std::numeric_limits<AtomMask>::digits;
+        using Bits = std::array<AtomMask, words>;
+
+        static constexpr auto lhs_indices = make_indices_1d<S, void, true, size, size>(atoms);
+        static constexpr auto rhs_indices = make_indices_1d<S, void, false, size, size>(atoms);
+        static constexpr auto cop_list = make_cop_list_1d<size, size>(atoms);
+        static constexpr auto rhs_types = make_rhs_type_list_1d<size, size>(atoms);
+
+        template<std::size_t Idx>
+        static constexpr void set_bit(Bits& bits, bool value) {
+            bits[Idx / std::numeric_limits<AtomMask>::digits] |= static_cast<AtomMask>(value) << (Idx % std::numeric_limits<AtomMask>::digits);
+        }
+
+        template<std::size_t... Idx>
+        static constexpr auto make_evaluator(std::index_sequence<Idx...>) {
+            return [selectors = std::make_tuple(make_selector<S, void, true, lhs_indices[Idx], rhs_indices[Idx], cop_list[Idx], rhs_types[Idx]>(atoms[Idx])...)](const auto& tuple) {
+                Bits bits{};
+                (..., set_bit<Idx>(bits, std::get<Idx>(selectors)(tuple)));
+                return bits;
+            };
+        }
+        static constexpr auto evaluator = make_evaluator(std::make_index_sequence<size>());
+
+        // the DNF terms of one query, with its own atom numbering translated to the merged one
+        template<typename Table>
+        static constexpr auto remap_terms() {
+            std::array<Bits, Table::masks.size()> terms{};
+            for (std::size_t t=0; t<Table::masks.size(); ++t) {
+                for (std::size_t i=0; i<Table::size; ++i) {
+                    if ((Table::masks[t] >> i) & 1) {
+                        const std::size_t j = find_atom(atoms, Table::atoms[i]);
+                        terms[t][j / std::numeric_limits<AtomMask>::digits] |= AtomMask{1} << (j % std::numeric_limits<AtomMask>::digits);
+                    }
+                }
+            }
+            return terms;
+        }
+
+        template<typename QP>
+        static constexpr auto terms = remap_terms<typename QP::WhereAtoms>();
+
+        template<typename QP>
+        static bool admits(const Bits& bits) {
+            if constexpr (QP::dnf_where_selector) {
+                for (const Bits& term: terms<QP>) {
+                    bool covered = true;
+                    for (std::size_t w=0; w<words; ++w) {
+                        covered = covered and (bits[w] & term[w]) == term[w];
+                    }
+                    if (covered) {
+                        return true;
+                    }
+                }
+                return false;
+            } else {
+                return true;
+            }
+        }
+
+        // pushes every row, in input order, to the folds (see operator/fold.h) of the queries that keep it
+        static void route(std::ranges::range auto& input, auto& folds) {
+            for (auto&& row: input) {
+                const Bits bits = evaluator(row);
+                [&]<std::size_t... Q>(std::index_sequence<Q...>) {
+                    (..., [&]() {
+                        if (admits<QPs>(bits)) {
+                            std::get<Q>(folds)->push(row);
+                        }
+                    }());
+                }(std::index_sequence_for<QPs...>());
+            }
+        }
+    };
+}
+}
+
+#endif //SQL_SHARED_SCAN_H
@@ -0,0 +1,299 @@
+#ifndef SQL_SORT_H
+#define SQL_SORT_H
+
+#include <vector>
+#include <algorithm>
+#include <bit>
+#include <future>
+#include <memory_resource>
+#include <span>
+#include <thread>
+#include <boost/sort/pdqsort/pdqsort.hpp>
+#include "common.h"
+#include "operator/memory.h"
+#include "profile/trace.h"
+
+namespace ctsql::impl
+{
+    constexpr bool same_output_column(const ColumnName& key, const ColumnName& out) {
+        if (key.table_name.empty() and key.agg == AggOp::NONE and not out.alias.empty() and key.column_name == out.alias) {
+            return true;
+        }
+        return key.agg == out.agg and key.table_name == out.table_name and key.column_name == out.column_name;
+    }
+
+    // position of every ORDER BY key in the result tuple:
+    //  - with a select list, the key has to name one of its columns
+    //  - with SELECT *, the result tuple is the schema tuple itself
+    template<Reflectable S1, Reflectable S2>
+    constexpr std::size_t order_index(const Query& query, const OrderKey& ok) {
+        if (query.cns.empty()) {
+            if (ok.column.agg != AggOp::NONE) {
+                throw std::runtime_error("ORDER BY aggregate requires it in the select list");
+            }
+            return get_index<S1, S2>(ok.column);
+        }
+        std::size_t pos = 0;
+        while (pos < query.cns.size() and not same_output_column(ok.column, query.cns[pos])) {
+            ++pos;
+        }
+        if (pos == query.cns.size()) {
+            throw std::runtime_error("ORDER BY column must appear in the select list");
+        }
+        return pos;
+    }
+
+    template<Reflectable S1, Reflectable S2, std::size_t N>
+    constexpr auto make_order_indices(const Query& query) {
+        std::array<std::size_t, N> indices{};
+        std::array<bool, N> descending{};
+        for (std::size_t i = 0; i < N; ++i) {
+            descending[i] = query.order_by[i].descending;
+            indices[i] = order_index<S1, S2>(query, query.order_by[i]);
+        }
+        return std::make_pair(indices, descending);
+    }
+
+    template<bool descending>
+    constexpr int three_way(const auto& lhs, const auto& rhs) {
+        const int ord = lhs < rhs ? -1 : (rhs < lhs ? 1 : 0);
+        return descending ? -ord : ord;
+    }
+
+    // lexicographic "comes before" on the ORDER BY keys; only the key fields of the tuples are touched
+    template<std::array indices, std::array descending, std::size_t... Idx>
+    constexpr auto make_order_comparator_impl(std::index_sequence<Idx...>) {
+        return [](const auto& lhs, const auto& rhs) {
+            int ord = 0;
+            (void) (... or ((ord = three_way<descending[Idx]>(std::get<indices[Idx]>(lhs), std::get<indices[Idx]>(rhs))) != 0));
+            return ord < 0;
+        };
+    }
+
+    template<std::array indices, std::array descending>
+    constexpr auto make_order_comparator() {
+        static_assert(indices.size() == descending.size());
+        return make_order_comparator_impl<indices, descending>(std::make_index_sequence<indices.size()>());
+    }
+
+    // the best n tuples seen so far, as a max-heap w.r.t. the ordering: memory is O(n) and each tuple pushed costs
+    // at most O(log n)
+    template<typename Tuple, auto comp>
+    class TopN {
+    public:
+        // no reserve: n is the LIMIT, which may be far more rows than the input has
+        TopN(std::size_t n, std::pmr::memory_resource* memory): n{n}, heap(memory) {}
+
+        void push(auto&& t) {
+            if (heap.size() < n) {
+                heap.emplace_back(std::forward<decltype(t)>(t));
+                std::push_heap(heap.begin(), heap.end(), comp);
+            } else if (n > 0 and comp(t, heap.front())) {
+                std::pop_heap(heap.begin(), heap.end(), comp);
+                heap.back() = std::forward<decltype(t)>(t);
+                std::push_heap(heap.begin(), heap.end(), comp);
+            }
+        }
+
+        // the tuples kept, in order; no more can be pushed
+        std::pmr::vector<Tuple>& sorted() {
+            std::sort_heap(heap.begin(), heap.end(), comp);
+            return heap;
+        }
+
+    private:
+        std::size_t n;
+        std::pmr::vector<Tuple> heap;
+    };
+
+    // ORDER BY ... LIMIT n
+    template<typename Tuple, auto comp>
+    std::generator<Tuple> top_n(std::ranges::range auto& input, std::size_t n) {
+        if (n == 0) {
+            co_return;
+        }
+        OperatorMemory memory("top n");
+        TopN<Tuple, comp> heap(n, &memory);
+        for (auto&& t: input) {
+            heap.push(t);
+        }
+        for (auto& t: heap.sorted()) {
+            co_yield std::move(t);
+        }
+    }
+
+    // keys that map order-preservingly onto an unsigned integer of the same width
+    template<typename T>
+    concept RadixKey = (std::integral<T> or std::floating_point<T>) and sizeof(T) <= sizeof(uint64_t);
+
+    template<typename T, bool descending>
+    constexpr uint64_t radix_encode(T v) {
+        constexpr int bits = sizeof(T) * 8;
+        constexpr uint64_t width_mask = bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+        constexpr uint64_t sign_bit = uint64_t(1) << (bits - 1);
+        uint64_t u;
+        if constexpr (std::floating_point<T>) {
+            using U = std::conditional_t<sizeof(T) == sizeof(uint32_t), uint32_t, uint64_t>;
+            u = std::bit_cast<U>(v);
+            u = (u & sign_bit) ? ~u & width_mask : u | sign_bit;  // negatives reversed, positives above them
+        } else if constexpr (std::signed_integral<T>) {
+            u = (static_cast<uint64_t>(v) & width_mask) ^ sign_bit;
+        } else {
+            u = static_cast<uint64_t>(v);
+        }
+        return descending ? ~u & width_mask : u;
+    }
+
+    template<std::size_t K>
+    struct RadixEntry {
+        std::array<uint64_t, K> keys;
+        std::size_t row;
+    };
+
+    // LSD radix sort, one byte per pass, from the last key's lowest byte to the first key's highest byte.
+    // every pass is stable, so rows with equal keys keep their input order.
+    // passes in which all entries share the same byte are skipped
+    template<std::array widths, std::size_t K>
+    void radix_sort(std::vector<RadixEntry<K>>& entries) {
+        std::vector<RadixEntry<K>> buffer(entries.size());
+        for (std::size_t k = K; k-- > 0;) {
+            for (std::size_t byte = 0; byte < widths[k]; ++byte) {
+                const int shift = static_cast<int>(byte * 8);
+                std::array<std::size_t, 256> offsets{};
+                for (const auto& e: entries) {
+                    ++offsets[(e.keys[k] >> shift) & 0xff];
+                }
+                if (std::ranges::find(offsets, entries.size()) != offsets.end()) {
+                    continue;
+                }
+                std::size_t sum = 0;
+                for (auto& o: offsets) {
+                    sum += std::exchange(o, sum);
+                }
+                for (auto& e: entries) {
+                    buffer[offsets[(e.keys[k] >> shift) & 0xff]++] = e;
+                }
+                entries.swap(buffer);
+            }
+        }
+    }
+
+    template<typename Tuple, std::array indices>
+    constexpr bool is_radix_sortable = []<std::size_t... Idx>(std::index_sequence<Idx...>) {
+        return (... and RadixKey<std::tuple_element_t<indices[Idx], Tuple>>);
+    }(std::make_index_sequence<indices.size()>());
+
+    // encodes only the key fields of each row, radix sorts (key, row) pairs, then moves the rows into place
+    template<typename Tuple, std::array indices, std::array descending>
+    void radix_sort_rows(std::span<Tuple> rows) {
+        constexpr std::size_t K = indices.size();
+        constexpr auto widths = []<std::size_t... Idx>(std::index_sequence<Idx...>) {
+            return std::array<std::size_t, K>{sizeof(std::tuple_element_t<indices[Idx], Tuple>)...};
+        }(std::make_index_sequence<K>());
+        std::vector<RadixEntry<K>> entries(rows.size());
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            [&]<std::size_t... Idx>(std::index_sequence<Idx...>) {
+                entries[i].keys = {radix_encode<std::tuple_element_t<indices[Idx], Tuple>, descending[Idx]>(std::get<indices[Idx]>(rows[i]))...};
+            }(std::make_index_sequence<K>());
+            entries[i].row = i;
+        }
+        radix_sort<widths>(entries);
+        std::vector<Tuple> sorted;
+        sorted.reserve(rows.size());
+        for (const auto& e: entries) {
+            sorted.emplace_back(std::move(rows[e.row]));
+        }
+        std::ranges::move(sorted, rows.begin());
+    }
+
+    template<typename Tuple, std::array indices, std::array descending>
+    void sort_range(std::span<Tuple> rows) {
+        if constexpr (is_radix_sortable<Tuple, indices>) {
+            radix_sort_rows<Tuple, indices, descending>(rows);
+        } else {
+            boost::sort::pdqsort(rows.begin(), rows.end(), make_order_comparator<indices, descending>());
+        }
+    }
+
+    // below this many rows per worker, threading costs more than it saves
+    static constexpr std::size_t parallel_sort_min_rows = 1 << 16;
+
+    // sorts `rows` in place. large inputs are cut into one chunk per worker, the chunks are sorted
+    // concurrently, then adjacent runs are merged pairwise (again concurrently) until one run is left.
+    // the scratch space of the chunk sorts and merges is not allocated from the rows' memory resource
+    template<typename Tuple, std::array indices, std::array descending, typename Allocator>
+    void sort_rows(std::vector<Tuple, Allocator>& rows, std::size_t workers = std::thread::hardware_concurrency()) {
+        workers = std::min(workers, rows.size() / parallel_sort_min_rows);
+        if (workers <= 1) {
+            sort_range<Tuple, indices, descending>(rows);
+            return;
+        }
+        std::vector<std::size_t> bounds;
+        for (std::size_t w = 0; w <= workers; ++w) {
+            bounds.push_back(rows.size() * w / workers);
+        }
+        std::vector<std::future<void>> tasks;
+        for (std::size_t w = 0; w < workers; ++w) {
+            std::span<Tuple> chunk(rows.data() + bounds[w], rows.data() + bounds[w + 1]);
+            tasks.push_back(std::async(std::launch::async, [chunk] {
+                [[maybe_unused]] TraceScope scope("sort chunk", "sort");
+                sort_range<Tuple, indices, descending>(chunk);
+            }));
+        }
+        for (auto& t: tasks) {
+            t.get();
+        }
+        constexpr auto comp = make_order_comparator<indices, descending>();
+        while (bounds.size() > 2) {
+            tasks.clear();
+            std::vector<std::size_t> merged{0};
+            for (std::size_t i = 0; i + 2 < bounds.size(); i += 2) {
+                auto first = rows.begin() + bounds[i], middle = rows.begin() + bounds[i + 1], last = rows.begin() + bounds[i + 2];
+                tasks.push_back(std::async(std::launch::async, [=] {
+                    [[maybe_unused]] TraceScope scope("merge runs", "sort");
+                    std::inplace_merge(first, middle, last, comp);
+                }));
+                merged.push_back(bounds[i + 2]);
+            }
+            if (merged.back() != rows.size()) {
+                merged.push_back(rows.size());  // odd run out, merged in the next round
+            }
+            for (auto& t: tasks) {
+                t.get();
+            }
+            bounds.swap(merged);
+        }
+    }
+
+    // full ORDER BY: materialize, then sort
+    template<typename Tuple, std::array indices, std::array descending>
+    std::generator<Tuple> sort_all(std::ranges::range auto& input) {
+        OperatorMemory memory("sort");
+        std::pmr::vector<Tuple> materialized(&memory);
+        for (auto&& t: input) {
+            materialized.emplace_back(t);
+        }
+        sort_rows<Tuple, indices, descending>(materialized);
+        for (auto& t: materialized) {
+            co_yield std::move(t);
+        }
+    }
+
+    // LIMIT n without ORDER BY: stop pulling as soon as n tuples are out.
+    // destroying the upstream generators stops scans, join probes and everything else below
+    template<typename Tuple>
+    std::generator<Tuple> take(std::ranges::range auto& input, std::size_t n) {
+        if (n == 0) {
+            co_return;
+        }
+        std::size_t produced = 0;
+        for (auto&& t: input) {
+            co_yield std::forward<decltype(t)>(t);
+            if (++produced == n) {
+                co_return;
+            }
+        }
+    }
+}
+
+#endif //SQL_SORT_H
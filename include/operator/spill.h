@@ -0,0 +1,284 @@
+#ifndef SQL_SPILL_H
+#define SQL_SPILL_H
+
+#include <__generator.hpp>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include "refl.hpp"
+#include "operator/memory.h"
+#if defined(__unix__)
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+// spilling of operators whose rows do not fit in the memory budget (see operator/memory.h) to temporary files: rows
+// are hash-partitioned to files and read back one partition at a time. a row is written in a compact binary form,
+// member by member: numbers as they are in memory, strings prefixed by their varint length; tuples (schema tuples
+// and the tuples of projections) and reflected schema objects are the sequence of their members.
+//
+//   ctsql::set_spill_directory("/mnt/scratch");  // the system's temporary directory by default
+
+namespace ctsql {
+namespace impl {
+    template<typename T>
+    struct is_tuple_like: std::false_type {};
+
+    template<typename... Ts>
+    struct is_tuple_like<std::tuple<Ts...>>: std::true_type {};
+
+    template<typename T, typename U>
+    struct is_tuple_like<std::pair<T, U>>: std::true_type {};
+
+    template<typename T>
+    constexpr bool is_spillable();
+
+    template<typename Member>
+    constexpr bool is_spillable_field() {
+        if constexpr (refl::descriptor::is_field(Member{})) {
+            return not Member::is_static and is_spillable<std::remove_cv_t<typename Member::value_type>>();
+        } else {
+            return true;  // functions are not stored
+        }
+    }
+
+    template<typename... Members>
+    constexpr bool are_spillable_fields(refl::type_list<Members...>) {
+        return (... or refl::descriptor::is_field(Members{})) and (... and is_spillable_field<Members>());
+    }
+
+    template<typename... Ts>
+    constexpr bool are_spillable(std::type_identity<std::tuple<Ts...>>) {
+        return (... and is_spillable<Ts>());
+    }
+
+    template<typename T, typename U>
+    constexpr bool are_spillable(std::type_identity<std::pair<T, U>>) {
+        return is_spillable<T>() and is_spillable<U>();
+    }
+
+    // a reflected struct qualifies by its fields, all of which must. refl also describes library types such as
+    // std::string_view, without fields: they would be written as nothing and read back empty
+    template<typename T>
+    constexpr bool is_spillable() {
+        if constexpr (std::is_arithmetic_v<T> or std::is_enum_v<T> or std::same_as<T, std::string>) {
+            return true;
+        } else if constexpr (is_tuple_like<T>::value) {
+            return are_spillable(std::type_identity<T>{});
+        } else if constexpr (refl::is_reflectable<T>() and std::is_default_constructible_v<T>) {
+            return are_spillable_fields(refl::member_list<T>{});
+        } else {
+            return false;
+        }
+    }
+
+    template<typename T>
+    concept Spillable = is_spillable<T>();
+
+    inline std::mutex spill_directory_mutex;
+    inline std::optional<std::filesystem::path> spill_directory;
+
+    inline std::filesystem::path spill_path() {
+        std::lock_guard lock(spill_directory_mutex);
+        return spill_directory ? spill_directory.value() : std::filesystem::temp_directory_path();
+    }
+
+    // an anonymous temporary file, gone once closed (or once the process exits); written first, then read back
+    class SpillFile {
+    public:
+        explicit SpillFile(OperatorMemory& memory): memory{memory} {
+#if defined(__unix__)
+            std::string path = (spill_path() / "ctsql-spill-XXXXXX").string();
+            const int fd = ::mkstemp(path.data());
+            if (fd >= 0) {
+                ::unlink(path.c_str());
+                file = ::fdopen(fd, "w+b");
+                if (not file) {
+                    ::close(fd);
+                }
+            }
+            if (not file) {
+                throw std::runtime_error("cannot create spill file in " + spill_path().string());
+            }
+#else
+            file = std::tmpfile();
+            if (not file) {
+                throw std::runtime_error("cannot create spill file");
+            }
+#endif
+        }
+        ~SpillFile() {
+            std::fclose(file);
+        }
+        SpillFile(const SpillFile&) = delete;
+        SpillFile& operator=(const SpillFile&) = delete;
+
+        template<Spillable Row>
+        void write(const Row& row) {
+            write_value(row);
+            ++num_rows;
+        }
+
+        // the rows written so far, in order; the file is read once
+        template<Spillable Row>
+        std::generator<Row> rows() {
+            if (std::fseek(file, 0, SEEK_SET) != 0) {
+                throw std::runtime_error("cannot rewind spill file");
+            }
+            for (std::size_t i = 0; i < num_rows; ++i) {
+                Row row{};
+                read_value(row);
+                co_yield std::move(row);
+            }
+        }
+
+        std::size_t size() const { return num_rows; }
+
+    private:
+        std::FILE* file = nullptr;
+        OperatorMemory& memory;
+        std::size_t num_rows = 0;
+
+        void put(const void* p, std::size_t n) {
+            if (std::fwrite(p, 1, n, file) != n) {
+                throw std::runtime_error("cannot write spill file: " + std::string(std::strerror(errno)));
+            }
+            memory.spill(n);
+        }
+
+        void get(void* p, std::size_t n) {
+            if (std::fread(p, 1, n, file) != n) {
+                throw std::runtime_error("truncated spill file");
+            }
+        }
+
+        template<typename T>
+        void write_value(const T& v) {
+            if constexpr (std::is_arithmetic_v<T> or std::is_enum_v<T>) {
+                put(&v, sizeof(T));
+            } else if constexpr (std::same_as<T, std::string>) {
+                std::array<unsigned char, 10> len{};
+                std::size_t n = 0;
+                for (uint64_t u = v.size(); ; u >>= 7) {
+                    len[n++] = static_cast<unsigned char>(u >= 0x80 ? (u & 0x7f) | 0x80 : u);
+                    if (u < 0x80) {
+                        break;
+                    }
+                }
+                put(len.data(), n);
+                put(v.data(), v.size());
+            } else if constexpr (is_tuple_like<T>::value) {
+                std::apply([this](const auto&... members) { (..., write_value(members)); }, v);
+            } else {
+                static_assert(Spillable<T>, "only numbers, strings, tuples and reflected structs of them can be spilled");
+                refl::util::for_each(refl::reflect<T>().members, [&](auto member) {
+                    if constexpr (refl::descriptor::is_field(member)) {
+                        write_value(member(v));
+                    }
+                });
+            }
+        }
+
+        template<typename T>
+        void read_value(T& v) {
+            if constexpr (std::is_arithmetic_v<T> or std::is_enum_v<T>) {
+                get(&v, sizeof(T));
+            } else if constexpr (std::same_as<T, std::string>) {
+                uint64_t n = 0;
+                for (unsigned shift = 0; ; shift += 7) {
+                    unsigned char b;
+                    get(&b, 1);
+                    n |= static_cast<uint64_t>(b & 0x7f) << shift;
+                    if (not (b & 0x80)) {
+                        break;
+                    }
+                }
+                v.resize(n);
+                get(v.data(), n);
+            } else if constexpr (is_tuple_like<T>::value) {
+                std::apply([this](auto&... members) { (..., read_value(members)); }, v);
+            } else {
+                static_assert(Spillable<T>, "only numbers, strings, tuples and reflected structs of them can be spilled");
+                refl::util::for_each(refl::reflect<T>().members, [&](auto member) {
+                    if constexpr (refl::descriptor::is_field(member)) {
+                        read_value(member(v));
+                    }
+                });
+            }
+        }
+    };
+
+    static constexpr std::size_t spill_fan_out = 16;
+    static constexpr std::size_t max_spill_level = 4;
+
+    // rows split by the hash of their key over fan_out files, created as they are first written to.
+    // every level of recursive partitioning mixes the hash differently, so that a partition too large for the budget
+    // splits again; rows of one key never do, which is why the levels are bounded
+    template<Spillable Row>
+    class SpillPartitions {
+    public:
+        static constexpr std::size_t fan_out = spill_fan_out;
+
+        SpillPartitions(OperatorMemory& memory, std::size_t level): memory{memory}, level{level} {}
+
+        void add(std::size_t hash, const Row& row) {
+            auto& file = files[partition(hash)];
+            if (not file) {
+                file = std::make_unique<SpillFile>(memory);
+            }
+            file->write(row);
+        }
+
+        bool empty(std::size_t p) const { return not files[p]; }
+
+        std::generator<Row> rows(std::size_t p) {
+            return files[p]->template rows<Row>();
+        }
+
+        // frees partition p once it has been read
+        void drop(std::size_t p) { files[p].reset(); }
+
+        // splitmix64 finalizer, seeded by the level
+        std::size_t partition(std::size_t hash) const {
+            uint64_t z = static_cast<uint64_t>(hash) + (level + 1) * 0x9e3779b97f4a7c15ull;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return static_cast<std::size_t>((z ^ (z >> 31)) % fan_out);
+        }
+
+    private:
+        OperatorMemory& memory;
+        std::size_t level;
+        std::array<std::unique_ptr<SpillFile>, fan_out> files;
+    };
+
+    template<typename Row>
+    struct SpillPartitionsFor {
+        using type = SpillPartitions<Row>;
+    };
+
+    // the partitions of rows that can be spilled; for others a placeholder, and the operator fails over its budget
+    template<typename Row>
+    using SpillPartitionsOf = typename std::conditional_t<Spillable<Row>, SpillPartitionsFor<Row>, std::type_identity<std::monostate>>::type;
+}
+
+    // where operators that exceed the memory budget put their temporary files; they are removed as soon as created,
+    // so nothing is left behind if the process dies
+    inline void set_spill_directory(std::filesystem::path path) {
+        std::lock_guard lock(impl::spill_directory_mutex);
+        impl::spill_directory = std::move(path);
+    }
+}
+
+#endif //SQL_SPILL_H
@@ -0,0 +1,206 @@
+#ifndef SQL_WINDOW_H
+#define SQL_WINDOW_H
+
+#include <cmath>
+#include <deque>
+#include <unordered_map>
+#include "common.h"
+#include "operator/projector.h"
+
+namespace ctsql {
+    // event-time windows [start, start + size) over a numeric timestamp column, with starts on multiples of slide.
+    // slide == size gives tumbling windows, slide < size hopping ones
+    template<refl::const_string column, auto size, auto slide = size>
+    struct Window {
+        static_assert(size > 0 and slide > 0 and slide <= size, "window slide must be in (0, size]");
+        static constexpr auto ts_column = column;
+        static constexpr auto window_size = size;
+        static constexpr auto window_slide = slide;
+    };
+
+    template<refl::const_string column, auto size>
+    using TumblingWindow = Window<column, size, size>;
+
+    template<refl::const_string column, auto size, auto slide>
+    using HoppingWindow = Window<column, size, slide>;
+
+namespace impl {
+    template<typename T>
+    concept IsWindow = requires {
+        T::ts_column;
+        T::window_size;
+        T::window_slide;
+    };
+
+    // MIN/MAX over a sliding window: values that can never be the extreme again are dropped on push,
+    // so the front is always the answer and each value is pushed & popped once
+    template<typename TS, typename T, bool keep_min>
+    class MonotonicDeque {
+    public:
+        void push(TS ts, const T& v) {
+            while (not q.empty() and (keep_min ? not (q.back().second < v) : not (v < q.back().second))) {
+                q.pop_back();
+            }
+            q.emplace_back(ts, v);
+        }
+
+        void evict(TS before) {
+            while (not q.empty() and q.front().first < before) {
+                q.pop_front();
+            }
+        }
+
+        const T& front() const { return q.front().second; }
+
+    private:
+        std::deque<std::pair<TS, T>> q;
+    };
+
+    // per-window aggregation of a single-table query. input has to arrive ordered by the timestamp column;
+    // a window is emitted as soon as an event at or past its end shows up, and at the end of a finite input
+    template<typename QP, typename W>
+    struct WindowAggregate {
+        using STuple = typename QP::STuple;
+        using PTuple = typename QP::PTuple;
+        static constexpr std::size_t ts_index = get_index<typename QP::S1Type, void>(BasicColumnName{"", W::ts_column.str_view()});
+        static_assert(ts_index < std::tuple_size_v<STuple>, "window timestamp column does not exist in the schema");
+        using TS = std::tuple_element_t<ts_index, STuple>;
+        static_assert(std::is_arithmetic_v<TS>, "window timestamp column must be numeric");
+        static constexpr TS size = W::window_size;
+        static constexpr TS slide = W::window_slide;
+
+        static constexpr std::array group_by_indices = make_group_by_indices<typename QP::S1Type, void, QP::res.group_by_keys.size()>(QP::res);
+        static constexpr auto gb_projector = make_projector<group_by_indices>();
+        using GBTuple = ProjectedTuple<STuple, group_by_indices>;
+        static constexpr auto projector = QP::projector.value();
+
+        // a window row is its start followed by the aggregated columns
+        using WindowRow = decltype(std::tuple_cat(std::declval<std::tuple<TS>>(), std::declval<PTuple>()));
+
+        template<std::size_t Idx>
+        using Extrema = std::conditional_t<QP::agg_ops[Idx] == AggOp::MIN or QP::agg_ops[Idx] == AggOp::MAX,
+                                           MonotonicDeque<TS, std::tuple_element_t<Idx, PTuple>, QP::agg_ops[Idx] == AggOp::MIN>, std::monostate>;
+
+        template<std::size_t... Idx>
+        static auto make_extrema(std::index_sequence<Idx...>) -> std::tuple<Extrema<Idx>...>;
+
+        static constexpr auto columns = std::make_index_sequence<std::tuple_size_v<PTuple>>();
+
+        // the events of the oldest open window; SUM/COUNT are running totals, MIN/MAX live in the deques
+        struct GroupState {
+            std::deque<std::pair<TS, PTuple>> events;
+            PTuple acc = make_tuple_reduction_base<PTuple, QP::agg_ops>();
+            decltype(make_extrema(columns)) extrema;
+        };
+        using Groups = std::unordered_map<GBTuple, GroupState, hash_tuple::hash<GBTuple>>;
+
+        template<std::size_t... Idx>
+        static void add(GroupState& state, TS ts, const PTuple& p, std::index_sequence<Idx...>) {
+            (..., [&]() {
+                constexpr AggOp agg = QP::agg_ops[Idx];
+                if constexpr (agg == AggOp::NONE) {
+                    std::get<Idx>(state.acc) = std::get<Idx>(p);
+                } else if constexpr (agg == AggOp::COUNT or agg == AggOp::SUM) {
+                    std::get<Idx>(state.acc) += std::get<Idx>(p);
+                } else {
+                    std::get<Idx>(state.extrema).push(ts, std::get<Idx>(p));
+                }
+            }());
+            state.events.emplace_back(ts, p);
+        }
+
+        template<std::size_t... Idx>
+        static void evict(GroupState& state, TS before, std::index_sequence<Idx...>) {
+            while (not state.events.empty() and state.events.front().first < before) {
+                const PTuple& p = state.events.front().second;
+                (..., [&]() {
+                    if constexpr (QP::agg_ops[Idx] == AggOp::COUNT or QP::agg_ops[Idx] == AggOp::SUM) {
+                        std::get<Idx>(state.acc) -= std::get<Idx>(p);
+                    }
+                }());
+                state.events.pop_front();
+            }
+            (..., [&]() {
+                if constexpr (QP::agg_ops[Idx] == AggOp::MIN or QP::agg_ops[Idx] == AggOp::MAX) {
+                    std::get<Idx>(state.extrema).evict(before);
+                }
+            }());
+        }
+
+        template<std::size_t... Idx>
+        static PTuple current(const GroupState& state, std::index_sequence<Idx...>) {
+            PTuple result = state.acc;
+            (..., [&]() {
+                if constexpr (QP::agg_ops[Idx] == AggOp::MIN or QP::agg_ops[Idx] == AggOp::MAX) {
+                    std::get<Idx>(result) = std::get<Idx>(state.extrema).front();
+                }
+            }());
+            return result;
+        }
+
+        // start of the earliest window containing ts
+        static constexpr TS first_start(TS ts) {
+            TS s;
+            if constexpr (std::is_floating_point_v<TS>) {
+                s = std::floor(ts / slide) * slide;
+            } else {
+                s = ts / slide * slide;
+                if constexpr (std::is_signed_v<TS>) {
+                    if (s > ts) {
+                        s -= slide;
+                    }
+                }
+            }
+            while ((std::is_signed_v<TS> or s >= slide) and s + size > ts + slide) {
+                s -= slide;
+            }
+            return s;
+        }
+
+        static std::generator<WindowRow> emit(const Groups& groups, TS start) {
+            for (const auto& kv: groups) {
+                co_yield std::tuple_cat(std::make_tuple(start), current(kv.second, columns));
+            }
+        }
+
+        static void advance(Groups& groups, TS start) {
+            for (auto it = groups.begin(); it != groups.end();) {
+                evict(it->second, start, columns);
+                it = it->second.events.empty() ? groups.erase(it) : std::next(it);
+            }
+        }
+
+        static std::generator<WindowRow> aggregate(std::ranges::range auto& input) {
+            Groups groups;  // only groups with events in the oldest open window
+            std::optional<TS> start, last;
+            for (auto&& row: input) {
+                const TS ts = std::get<ts_index>(row);
+                if (last and ts < *last) {
+                    throw std::runtime_error("window input must be ordered by its timestamp column");
+                }
+                last = ts;
+                if (not start) {
+                    start = first_start(ts);
+                }
+                while (ts >= *start + size) {  // the oldest open window is complete
+                    co_yield std::ranges::elements_of(emit(groups, *start));
+                    *start += slide;
+                    advance(groups, *start);
+                    if (groups.empty()) {  // skip the windows in between that have no events
+                        start = first_start(ts);
+                    }
+                }
+                add(groups[gb_projector(row)], ts, projector(row), columns);
+            }
+            // the end of a finite input closes the windows still open
+            while (not groups.empty()) {
+                co_yield std::ranges::elements_of(emit(groups, *start));
+                *start += slide;
+                advance(groups, *start);
+            }
+        }
+    };
+}
+}
+
+#endif //SQL_WINDOW_H
@@ -48,6 +48,18 @@ namespace impl {
     static constexpr char by_pattern[] = "[bB][yY]";
     static constexpr ctpg::regex_term<by_pattern> by_kw{"by_kw"};
 
+    static constexpr char order_pattern[] = "[oO][rR][dD][eE][rR]";
+    static constexpr ctpg::regex_term<order_pattern> order_kw{"order_kw"};
+
+    static constexpr char asc_pattern[] = "[aA][sS][cC]";
+    static constexpr ctpg::regex_term<asc_pattern> asc_kw{"asc_kw"};
+
+    static constexpr char desc_pattern[] = "[dD][eE][sS][cC]";
+    static constexpr ctpg::regex_term<desc_pattern> desc_kw{"desc_kw"};
+
+    static constexpr char limit_pattern[] = "[lL][iI][mM][iI][tT]";
+    static constexpr ctpg::regex_term<limit_pattern> limit_kw{"limit_kw"};
+
     static constexpr ctpg::nterm<AggOp> agg_kws{"agg_kws"};
     static constexpr auto agg_kws_rules = ctpg::rules(
         agg_kws(count_kw) >= [](std::string_view) { return AggOp::COUNT; },
@@ -60,7 +72,8 @@ namespace impl {
 namespace impl_exp {
     static constexpr auto kw_terms = ctpg::terms(impl::select_kw, impl::as_kw, impl::from_kw, impl::where_kw, impl::on_kw,
                                                  impl::count_kw, impl::sum_kw, impl::max_kw, impl::min_kw,
-                                                 impl::not_kw, impl::and_kw, impl::or_kw, impl::group_kw, impl::by_kw);
+                                                 impl::not_kw, impl::and_kw, impl::or_kw, impl::group_kw, impl::by_kw,
+                                                 impl::order_kw, impl::asc_kw, impl::desc_kw, impl::limit_kw);
     static constexpr auto kw_nterms = ctpg::nterms(impl::agg_kws);
     static constexpr auto kw_rules = std::tuple_cat(impl::agg_kws_rules);
 }
@@ -31,6 +31,15 @@ namespace impl {
         comp_ops(neq) >= [](std::string_view) { return CompOp::NEQ; }
     );
 
+    // placeholders of prepared queries: positional ? or named :name
+    static constexpr char named_param_pattern[] = ":[a-zA-Z_][a-zA-Z0-9_]*";
+    static constexpr ctpg::regex_term<named_param_pattern> named_param{"named_param"};
+    static constexpr ctpg::nterm<Param> parameter{"parameter"};
+    static constexpr auto parameter_rules = ctpg::rules(
+        parameter('?') >= [](char) { return Param{}; },
+        parameter(named_param) >= [](std::string_view name) { return Param{name.substr(1)}; }
+    );
+
     static constexpr ctpg::nterm<BooleanFactor<true>> boolean_factor_one_side{"boolean_factor_one_side"};
     static constexpr ctpg::nterm<BooleanFactor<false>> boolean_factor_two_side{"boolean_factor_two_side"};
     static constexpr auto boolean_factor_rules = ctpg::rules(
@@ -46,6 +55,10 @@ namespace impl {
             [](BasicColumnName lhs, CompOp cop, double rhs) { return BooleanFactor<true>(cop, lhs, rhs); },
         boolean_factor_one_side(floating_point, comp_ops, basic_column_name) >=
             [](double rhs, CompOp cop, BasicColumnName lhs) { return BooleanFactor<true>(invert(cop), lhs, rhs); },
+        boolean_factor_one_side(basic_column_name, comp_ops, parameter) >=
+            [](BasicColumnName lhs, CompOp cop, Param rhs) { return BooleanFactor<true>(cop, lhs, rhs); },
+        boolean_factor_one_side(parameter, comp_ops, basic_column_name) >=
+            [](Param rhs, CompOp cop, BasicColumnName lhs) { return BooleanFactor<true>(invert(cop), lhs, rhs); },
         boolean_factor_one_side(not_kw, boolean_factor_one_side) >=
             [](std::string_view, BooleanFactor<true> bf) { bf.cop = negate(bf.cop); return bf; },
         boolean_factor_two_side(not_kw, boolean_factor_two_side) >=
@@ -77,12 +90,12 @@ namespace impl {
 }
 
 namespace impl_exp {
-    static constexpr auto logical_terms = ctpg::terms(impl::eq, impl::gt, impl::lt, impl::geq, impl::leq, impl::neq);
-    static constexpr auto logical_nterms = ctpg::nterms(impl::basic_column_name, impl::comp_ops,
+    static constexpr auto logical_terms = ctpg::terms(impl::eq, impl::gt, impl::lt, impl::geq, impl::leq, impl::neq, '?', impl::named_param);
+    static constexpr auto logical_nterms = ctpg::nterms(impl::basic_column_name, impl::comp_ops, impl::parameter,
                                                         impl::boolean_factor_one_side, impl::boolean_factor_two_side,
                                                         impl::boolean_and_terms_one_side, impl::boolean_and_terms_two_side,
                                                         impl::boolean_or_terms_one_side, impl::boolean_or_terms_two_side);
-    static constexpr auto logical_rules = std::tuple_cat(impl::basic_column_name_rules, impl::comp_op_rules, impl::boolean_factor_rules, impl::and_or_rules);
+    static constexpr auto logical_rules = std::tuple_cat(impl::basic_column_name_rules, impl::comp_op_rules, impl::parameter_rules, impl::boolean_factor_rules, impl::and_or_rules);
 }
 
 }
@@ -12,8 +12,30 @@
 
 namespace ctsql {
     static constexpr ctpg::nterm<Query> query_without_group_by{"query_without_group_by"};
+    static constexpr ctpg::nterm<Query> query_without_order_by{"query_without_order_by"};
     static constexpr ctpg::nterm<Query> query{"query"};
 
+    // ORDER BY keys: a column of the select list, optionally followed by ASC/DESC
+    static constexpr ctpg::nterm<OrderKey> order_key{"order_key"};
+    static constexpr ctpg::nterm<OrderKeys> order_key_list{"order_key_list"};
+    static constexpr auto order_by_rules = ctpg::rules(
+            order_key(impl::col_name_no_alias) >= [](ColumnName cn) { return OrderKey{cn, false}; },
+            order_key(impl::col_name_no_alias, impl::asc_kw) >= [](ColumnName cn, std::string_view) { return OrderKey{cn, false}; },
+            order_key(impl::col_name_no_alias, impl::desc_kw) >= [](ColumnName cn, std::string_view) { return OrderKey{cn, true}; },
+            order_key_list(order_key) >= [](OrderKey ok) { return OrderKeys{ok, 1}; },
+            order_key_list(order_key_list, ',', order_key) >= [](OrderKeys oks, char, OrderKey ok) {
+                oks.push_back(ok);
+                return oks;
+            }
+    );
+
+    constexpr std::size_t check_limit(int64_t limit) {
+        if (limit < 0) {
+            throw std::runtime_error("LIMIT must not be negative");
+        }
+        return static_cast<std::size_t>(limit);
+    }
+
     static constexpr auto query_rules = ctpg::rules(
             query_without_group_by(impl::select_kw, impl::col_name_list,
                                    impl::from_kw, impl::tab_name, ',', impl::tab_name,
@@ -36,10 +58,27 @@ namespace ctsql {
             [](std::string_view, ColumnNames cns, std::string_view, TableNames tns) {
                 return Query(cns, tns, BooleanOrTerms<false>{}, BooleanOrTerms<true>{}, {});
             },
-            query(query_without_group_by) >= [](Query query){ return query; },
-            query(query_without_group_by, impl::group_kw, impl::by_kw, impl::col_name_list) >= [](Query query, std::string_view, std::string_view, ColumnNames cns){
+            query_without_order_by(query_without_group_by) >= [](Query query){ return query; },
+            query_without_order_by(query_without_group_by, impl::group_kw, impl::by_kw, impl::col_name_list) >= [](Query query, std::string_view, std::string_view, ColumnNames cns){
                 query.group_by_keys = cns;
                 return query;
+            },
+            query(query_without_order_by) >= [](Query query){ return query; },
+            query(query_without_order_by, impl::order_kw, impl::by_kw, order_key_list) >=
+            [](Query query, std::string_view, std::string_view, OrderKeys oks) {
+                query.order_by = oks;
+                return query;
+            },
+            query(query_without_order_by, impl::limit_kw, impl::integer) >=
+            [](Query query, std::string_view, int64_t limit) {
+                query.limit = check_limit(limit);
+                return query;
+            },
+            query(query_without_order_by, impl::order_kw, impl::by_kw, order_key_list, impl::limit_kw, impl::integer) >=
+            [](Query query, std::string_view, std::string_view, OrderKeys oks, std::string_view, int64_t limit) {
+                query.order_by = oks;
+                query.limit = check_limit(limit);
+                return query;
             }
     );
 
@@ -48,8 +87,8 @@ namespace ctsql {
         static constexpr ctpg::parser p {
                 query,
                 std::tuple_cat(impl_exp::kw_terms, impl_exp::ident_terms, impl_exp::numeral_terms, impl_exp::logical_terms),
-                std::tuple_cat(impl_exp::kw_nterms, impl_exp::ident_nterms, impl_exp::numeral_nterms, impl_exp::logical_nterms, ctpg::nterms(query_without_group_by, query)),
-                std::tuple_cat(impl_exp::kw_rules, impl_exp::ident_rules, impl_exp::numeral_rules, impl_exp::logical_rules, query_rules)
+                std::tuple_cat(impl_exp::kw_nterms, impl_exp::ident_nterms, impl_exp::numeral_nterms, impl_exp::logical_nterms, ctpg::nterms(query_without_group_by, query_without_order_by, query, order_key, order_key_list)),
+                std::tuple_cat(impl_exp::kw_rules, impl_exp::ident_rules, impl_exp::numeral_rules, impl_exp::logical_rules, order_by_rules, query_rules)
         };
     };
 
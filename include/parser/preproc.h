@@ -52,9 +52,12 @@ namespace impl {
                 }
             }
         };
-        // de-alias select-list & group by keys
+        // de-alias select-list & group by keys & order by keys
         std::for_each(query.cns.begin(), query.cns.end(), substitute);
         std::for_each(query.group_by_keys.begin(), query.group_by_keys.end(), substitute);
+        for (auto& ok: query.order_by) {
+            substitute(ok.column);
+        }
         // de-alias condition lists
         for (auto& bat: query.join_condition) {
             for (auto& bf: bat) {
@@ -70,6 +73,18 @@ namespace impl {
         return query;
     }
 
+    constexpr bool is_output_alias(const Query& query, const ColumnName& cn) {
+        if (not cn.table_name.empty() or cn.agg != AggOp::NONE) {
+            return false;
+        }
+        for (const auto& out: query.cns) {
+            if (out.alias == cn.column_name) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     template<Reflectable S1, Reflectable S2=void>
     constexpr auto resolve_table_name(Query query) {
         auto substitute = [&query](auto& cn) {
@@ -88,6 +103,12 @@ namespace impl {
         // de-alias select-list & group-by keys
         std::for_each(query.cns.begin(), query.cns.end(), substitute);
         std::for_each(query.group_by_keys.begin(), query.group_by_keys.end(), substitute);
+        // order by keys may also name a column by its alias in the select list; those are left alone
+        for (auto& ok: query.order_by) {
+            if (not is_output_alias(query, ok.column)) {
+                substitute(ok.column);
+            }
+        }
         // de-alias condition lists
         for (auto& bat: query.join_condition) {
             for (auto& bf: bat) {
@@ -114,6 +135,39 @@ namespace impl {
         return query;
     }
 
+    // give every placeholder of the WHERE clause its position in the bind tuple:
+    // each ? takes the next position, a :name takes one the first time it shows up
+    constexpr auto number_params(Query query) {
+        ctpg::stdex::cvector<std::string_view, MaxAndTerms * MaxOrTerms> names;  // by position; empty for ?
+        for (auto& bat: query.where_condition) {
+            for (auto& bf: bat) {
+                if (auto* param = std::get_if<Param>(&bf.rhs)) {
+                    std::size_t pos = names.size();
+                    if (not param->name.empty()) {
+                        for (pos = 0; pos < names.size() and names[pos] != param->name; ++pos) {}
+                    }
+                    if (pos == names.size()) {
+                        names.push_back(param->name);
+                    }
+                    param->index = pos;
+                }
+            }
+        }
+        return query;
+    }
+
+    constexpr std::size_t count_params(const Query& query) {
+        std::size_t cnt = 0;
+        for (const auto& bat: query.where_condition) {
+            for (const auto& bf: bat) {
+                if (const auto* param = std::get_if<Param>(&bf.rhs)) {
+                    cnt = std::max(cnt, param->index + 1);
+                }
+            }
+        }
+        return cnt;
+    }
+
     template<std::size_t N>
     constexpr void increment_carrying_indices(std::array<std::size_t, N>& indices, const std::array<std::size_t, N>& limits) {
         for (size_t i = 0; i < N; ++i) {
@@ -127,6 +181,9 @@ namespace impl {
     }
 
     constexpr std::size_t compute_number_of_cnf_clauses(const BooleanOrTerms<true>& dnf) {
+        if (dnf.empty()) {  // no condition at all -> no clause, rather than a single empty clause
+            return 0;
+        }
         size_t num_cnf_clauses = 1;
         std::for_each(dnf.begin(), dnf.end(), [&num_cnf_clauses](const auto& bat){ num_cnf_clauses *= bat.size();});
         return num_cnf_clauses;
@@ -1,71 +1,108 @@
 #ifndef SQL_PLANNER_H
 #define SQL_PLANNER_H
 #include <__generator.hpp>
+#include <unordered_map>
+#include <functional>
 #include "common.h"
 #include "parser/parser.h"
 #include "parser/preproc.h"
 #include "operator/selector.h"
 #include "operator/projector.h"
 #include "operator/join.h"
+#include "operator/sort.h"
+#include "operator/clustered.h"
+#include "operator/window.h"
+#include "operator/batch.h"
+#include "operator/shared_scan.h"
+#include "operator/constant_eval.h"
+#include "operator/memory.h"
+#include "operator/spill.h"
+#include "operator/fold.h"
+#include "index/indexed_table.h"
+#include "index/sorted_index.h"
+#include "index/hash_index.h"
+#include "index/zone_map.h"
+#include "profile/instrument.h"
+#include "profile/explain.h"
 
 namespace ctsql {
 namespace impl {
-    // CREDIT: https://stackoverflow.com/questions/7110301/generic-hash-for-tuples-in-unordered-map-unordered-set
-    // usage be like: unordered_set<tuple<double, int>, hash_tuple::hash<tuple<double, int>>> dict;
-    namespace hash_tuple{
-        template <typename TT>
-        struct hash
-        {
-            size_t
-            operator()(TT const& tt) const
-            {
-                return std::hash<TT>()(tt);
-            }
-        };
+    // CNF of the WHERE clause of a single-table query; only computed when an access path asks for it
+    template<typename QP>
+    struct WhereCNF {
+        static constexpr size_t clause_size = QP::res.where_condition.size();
+        static constexpr size_t num_clauses = compute_number_of_cnf_clauses(QP::res.where_condition);
+        static constexpr auto cnf = dnf_to_cnf<num_clauses, clause_size>(QP::res.where_condition);
+        static constexpr auto inner_dim = make_inner_dim<cnf.size()>(clause_size);
+    };
 
-        namespace {
-            template <class T>
-            inline void hash_combine(std::size_t& seed, T const& v)
-            {
-                seed ^= hash_tuple::hash<T>()(v) + 0x9e3779b9 + (seed<<6) + (seed>>2);
-            }
-        }
+    enum class AccessPath {
+        FULL_SCAN, RANGE_SCAN, POINT_LOOKUP, ZONE_SCAN
+    };
 
-        namespace {
-            // Recursive template code derived from Matthieu M.
-            template <class Tuple, size_t Index = std::tuple_size<Tuple>::value - 1>
-            struct HashValueImpl
-            {
-                static void apply(size_t& seed, Tuple const& tuple)
-                {
-                    HashValueImpl<Tuple, Index-1>::apply(seed, tuple);
-                    hash_combine(seed, std::get<Index>(tuple));
+    template<Reflectable S, typename CNFSource, typename Input>
+    constexpr AccessPath choose_access_path() {
+        if constexpr (IsIndexedTable<Input> and not has_params(CNFSource::cnf)) {  // indexes need the values at compile time
+            using Index = typename Input::IndexType;
+            if constexpr (std::is_same_v<typename Index::SchemaType, S>) {
+                if constexpr (IsSortedIndex<Index>) {
+                    if (RangeScan<S, CNFSource, Index>::usable) {
+                        return AccessPath::RANGE_SCAN;
+                    }
+                } else if constexpr (IsHashIndex<Index>) {
+                    if (PointLookup<S, CNFSource, Index>::usable) {
+                        return AccessPath::POINT_LOOKUP;
+                    }
+                } else if constexpr (IsZoneMap<Index>) {
+                    if (ZoneScan<S, CNFSource, Index>::usable) {
+                        return AccessPath::ZONE_SCAN;
+                    }
                 }
-            };
+            }
+        }
+        return AccessPath::FULL_SCAN;
+    }
 
-            template <class Tuple>
-            struct HashValueImpl<Tuple,0>
-            {
-                static void apply(size_t& seed, Tuple const& tuple)
-                {
-                    hash_combine(seed, std::get<0>(tuple));
-                }
-            };
+    // scan a base table, keeping the tuples that satisfy selector.
+    // if the table comes with an index that can answer part of the CNF (described by CNFSource), the index is used
+    // and only the remaining clauses are checked
+    template<Reflectable S, typename CNFSource, auto selector>
+    auto scan(std::ranges::range auto& input, const auto&... params) {
+        using Input = std::remove_cvref_t<decltype(input)>;
+        constexpr AccessPath path = choose_access_path<S, CNFSource, Input>();
+        constexpr std::string_view table = refl::reflect<S>().name.str_view();
+        if constexpr (path == AccessPath::RANGE_SCAN) {
+            return instrument("range scan", table, RangeScan<S, CNFSource, typename Input::IndexType>::scan(input), known_size(input));
+        } else if constexpr (path == AccessPath::POINT_LOOKUP) {
+            return instrument("point lookup", table, PointLookup<S, CNFSource, typename Input::IndexType>::scan(input), known_size(input));
+        } else if constexpr (path == AccessPath::ZONE_SCAN) {
+            return instrument("zone scan", table, ZoneScan<S, CNFSource, typename Input::IndexType>::scan(input), known_size(input));
+        } else {
+            return instrument("scan", table, filter<selector>(input, params...), known_size(input));
         }
+    }
 
-        template <typename ... TT>
-        struct hash<std::tuple<TT...>>
-        {
-            size_t
-            operator()(std::tuple<TT...> const& tt) const
-            {
-                size_t seed = 0;
-                HashValueImpl<std::tuple<TT...> >::apply(seed, tt);
-                return seed;
-            }
-        };
+    template<typename T>
+    struct is_params : std::false_type {};
+
+    template<typename... Ts>
+    struct is_params<Params<Ts...>> : std::true_type {};
+
+    template<typename T>
+    concept IsParams = is_params<T>::value;
+
+    // a query with placeholders takes exactly one bind tuple, holding one value per placeholder
+    template<typename QP, typename... Bound>
+    constexpr void check_params() {
+        static_assert(sizeof...(Bound) <= 1);
+        static_assert(QP::num_params == 0 or sizeof...(Bound) == 1, "the query has placeholders; pass their values with bind_params");
+        static_assert((... and (std::tuple_size_v<decltype(Bound::values)> == QP::num_params)), "the number of bound values does not match the placeholders");
     }
 
+    enum class IndexJoinSide {
+        NONE, LEFT, RIGHT
+    };
+
     template<bool admits_eq_join, typename QPI>
     struct Join;
 
@@ -89,8 +126,8 @@ namespace impl {
         using S1HJT = ProjectedTuple<SchemaTuple<S1>, t0_hj_indices>;
         using S2HJT = ProjectedTuple<SchemaTuple<S2>, t1_hj_indices>;
         static_assert(std::is_same_v<S1HJT, S2HJT>, "misaligned types on equi-join conditions; please fix types and retry");
-        using S1Dict = std::unordered_map<S1HJT, std::vector<SchemaTuple<S1>>, hash_tuple::hash<S1HJT>>;
-        using S2Dict = std::unordered_map<S2HJT, std::vector<SchemaTuple<S2>>, hash_tuple::hash<S2HJT>>;
+        using S1Dict = std::pmr::unordered_map<S1HJT, std::pmr::vector<SchemaTuple<S1>>, hash_tuple::hash<S1HJT>>;
+        using S2Dict = std::pmr::unordered_map<S2HJT, std::pmr::vector<SchemaTuple<S2>>, hash_tuple::hash<S2HJT>>;
 
         // make a selector from the non-eq join conditions, if there's any
         static constexpr std::optional non_eq_selector = the_rest_jc.empty() ? std::nullopt : std::optional{impl::make_selector_and_cons<S1, S2, false,
@@ -100,61 +137,238 @@ namespace impl {
                 impl::make_rhs_type_list_1d<the_rest_jc.size(), the_rest_jc.size()>(the_rest_jc), the_rest_jc.size()>(the_rest_jc)};
 
         // handles the non-eq part of join & where conditions
-        static inline constexpr bool predicate(const auto& lr_tuple) {
+        static inline constexpr bool predicate(const auto& lr_tuple, const auto&... params) {
             if constexpr (non_eq_selector and where_two_tuple_selector) {
-                return non_eq_selector.value()(lr_tuple) and where_two_tuple_selector.value()(lr_tuple);
+                return non_eq_selector.value()(lr_tuple) and where_two_tuple_selector.value()(lr_tuple, params...);
             } else if constexpr (non_eq_selector) {
                 return non_eq_selector.value()(lr_tuple);
             } else if constexpr (where_two_tuple_selector) {
-                return where_two_tuple_selector.value()(lr_tuple);
+                return where_two_tuple_selector.value()(lr_tuple, params...);
             } else {
                 return true;
             }
         }
 
+        // index nested-loop join: a side carrying a hash index over (a subset of) its equi-join columns is never scanned;
+        // the other side probes the prebuilt index tuple by tuple.
+        // for every index column, we find the column of the probing side it is equated with
+        template<typename Index, bool index_on_right>
+        static constexpr auto make_probe_indices() {
+            constexpr const auto& indexed_side = index_on_right ? t1_hj_indices : t0_hj_indices;
+            constexpr const auto& probing_side = index_on_right ? t0_hj_indices : t1_hj_indices;
+            std::array<std::size_t, Index::key_indices.size()> probe_indices{};
+            bool usable = true;
+            for (std::size_t k = 0; k < probe_indices.size(); ++k) {
+                auto pos = std::find(indexed_side.begin(), indexed_side.end(), Index::key_indices[k]);
+                if (pos == indexed_side.end()) {
+                    usable = false;
+                } else {
+                    probe_indices[k] = probing_side[pos - indexed_side.begin()];
+                }
+            }
+            return std::make_pair(usable, probe_indices);
+        }
+
+        template<typename Input, bool on_right>
+        static constexpr bool can_probe() {
+            if constexpr (IsIndexedTable<Input>) {
+                using Index = typename Input::IndexType;
+                if constexpr (IsHashIndex<Index> and std::is_same_v<typename Index::SchemaType, std::conditional_t<on_right, S2, S1>>) {
+                    return make_probe_indices<Index, on_right>().first;
+                }
+            }
+            return false;
+        }
+
+        template<typename L, typename R>
+        static constexpr IndexJoinSide index_join_side() {
+            if constexpr (can_probe<R, true>()) {
+                return IndexJoinSide::RIGHT;
+            } else if constexpr (can_probe<L, false>()) {
+                return IndexJoinSide::LEFT;
+            } else {
+                return IndexJoinSide::NONE;
+            }
+        }
+
+        template<bool index_on_right>
+        static std::generator<SchemaTuple2<S1, S2>> probe(std::ranges::range auto& probe_input, const IsIndexedTable auto& indexed, const auto&... params) {
+            using Index = std::remove_cvref_t<decltype(indexed.index)>;
+            static constexpr std::array probe_indices = make_probe_indices<Index, index_on_right>().second;
+            static constexpr auto probe_projector = make_projector<probe_indices>();
+            // the lookup only guarantees equality on the indexed columns
+            static constexpr bool covers_eq_jc = probe_indices.size() == eq_jc.size();
+            // push-down selector of the indexed side, which is not scanned
+            static constexpr std::optional indexed_selector = []() {
+                if constexpr (index_on_right) { return QPI::t1_selector; }
+                else { return QPI::t0_selector; }
+            }();
+            check_index_fresh(indexed.index.size(), std::ranges::size(indexed.table));
+            for (auto&& p_tuple: probe_input) {
+                count_input();
+                for (auto row_id: indexed.index.lookup(probe_projector(p_tuple))) {
+                    const auto& i_tuple = indexed.table[row_id];
+                    if constexpr (indexed_selector) {
+                        if (not indexed_selector.value()(i_tuple, params...)) {
+                            continue;
+                        }
+                    }
+                    const auto& l_tuple = std::get<index_on_right ? 0 : 1>(std::tie(p_tuple, i_tuple));
+                    const auto& r_tuple = std::get<index_on_right ? 1 : 0>(std::tie(p_tuple, i_tuple));
+                    if constexpr (not covers_eq_jc) {
+                        if (t0_hj_projector(l_tuple) != t1_hj_projector(r_tuple)) {
+                            continue;
+                        }
+                    }
+                    auto lr_tuple = std::tuple_cat(l_tuple, r_tuple);
+                    if (predicate(lr_tuple, params...)) {
+                        co_yield lr_tuple;
+                    }
+                }
+            }
+        }
+
+        // the probing side still gets its push-down selector (and access path)
+        static std::generator<SchemaTuple2<S1, S2>> index_join(std::ranges::range auto& l_input, std::ranges::range auto& r_input, const auto&... params) {
+            constexpr IndexJoinSide side = index_join_side<std::remove_cvref_t<decltype(l_input)>, std::remove_cvref_t<decltype(r_input)>>();
+            static_assert(side != IndexJoinSide::NONE);
+            if constexpr (side == IndexJoinSide::RIGHT) {
+                if constexpr (QPI::t0_selector) {
+                    auto l_filtered = scan<S1, typename QPI::T0CNF, QPI::t0_selector.value()>(l_input, params...);
+                    co_yield std::ranges::elements_of(probe<true>(l_filtered, r_input, params...));
+                } else {
+                    co_yield std::ranges::elements_of(probe<true>(l_input, r_input, params...));
+                }
+            } else {
+                if constexpr (QPI::t1_selector) {
+                    auto r_filtered = scan<S2, typename QPI::T1CNF, QPI::t1_selector.value()>(r_input, params...);
+                    co_yield std::ranges::elements_of(probe<false>(r_filtered, l_input, params...));
+                } else {
+                    co_yield std::ranges::elements_of(probe<false>(r_input, l_input, params...));
+                }
+            }
+        }
+
         // we build hash table using the smaller of the two inputs
         static std::generator<SchemaTuple2<S1, S2>> join(std::ranges::range auto& l_input, std::ranges::range auto& r_input,
-                                                         std::size_t l_estimated_size, std::size_t r_estimated_size) {
+                                                         std::size_t l_estimated_size, std::size_t r_estimated_size, const auto&... params) {
             const auto l_size = get_input_size(l_input, l_estimated_size);
             const auto r_size = get_input_size(r_input, r_estimated_size);
-            // standard hash-join; a bit repetitive but should be okay
+            OperatorMemory memory("hash join");  // the hash table, rows included
             if (l_size <= r_size) {  // cannot be determined at compile-time
-                S1Dict s1d;
-                for (auto&& l_tuple: l_input) {
-                    auto& v = s1d[t0_hj_projector(l_tuple)];
-                    v.emplace_back(l_tuple);
+                co_yield std::ranges::elements_of(hash_join<true>(l_input, r_input, memory, 0, params...));
+            } else {
+                co_yield std::ranges::elements_of(hash_join<false>(r_input, l_input, memory, 0, params...));
+            }
+        }
+
+        template<bool build_left>
+        using BuildTuple = SchemaTuple<std::conditional_t<build_left, S1, S2>>;
+        template<bool build_left>
+        using ProbeTuple = SchemaTuple<std::conditional_t<build_left, S2, S1>>;
+
+        template<bool left>
+        static auto key_of(const auto& tuple) {
+            if constexpr (left) {
+                return t0_hj_projector(tuple);
+            } else {
+                return t1_hj_projector(tuple);
+            }
+        }
+
+        template<bool build_left>
+        static auto joined(const auto& b_tuple, const auto& p_tuple) {
+            if constexpr (build_left) {
+                return std::tuple_cat(b_tuple, p_tuple);
+            } else {
+                return std::tuple_cat(p_tuple, b_tuple);
+            }
+        }
+
+        // standard hash join; a build side over the memory budget turns it into a grace hash join: both sides are
+        // partitioned to disk on the join keys, and each pair of partitions is joined the same way, one at a time.
+        // level counts the partitionings so far; rows read back from disk were already counted as input
+        template<bool build_left>
+        static std::generator<SchemaTuple2<S1, S2>> hash_join(std::ranges::range auto& build_input, std::ranges::range auto& probe_input,
+                                                              OperatorMemory& memory, std::size_t level, const auto&... params) {
+            using Dict = std::conditional_t<build_left, S1Dict, S2Dict>;
+            using Hash = hash_tuple::hash<S1HJT>;
+            // rows with a column that cannot be written to disk (e.g. a std::string_view) fail over the budget instead
+            constexpr bool spillable = Spillable<BuildTuple<build_left>> and Spillable<ProbeTuple<build_left>>;
+            Dict table(&memory);
+            std::optional<SpillPartitionsOf<BuildTuple<build_left>>> spilled;
+            {
+                std::optional<Phase<>> build;  // partitions read back are part of the join's own work
+                if (level == 0) {
+                    build.emplace("build", refl::reflect<std::conditional_t<build_left, S1, S2>>().name.str_view());
                 }
-                for (auto&& r_tuple: r_input) {
-                    const auto& r_key = t1_hj_projector(r_tuple);
-                    auto pos = s1d.find(r_key);
-                    if (pos != s1d.end()) {
-                        for (const auto& l_tuple: pos->second) {
-                            auto lr_tuple = std::tuple_cat(l_tuple, r_tuple);
-                            if (predicate(lr_tuple)) {
-                                co_yield lr_tuple;
+                for (auto&& b_tuple: build_input) {
+                    if (level == 0) {
+                        count_input();
+                    }
+                    if (not spilled) {
+                        try {
+                            table[key_of<build_left>(b_tuple)].emplace_back(b_tuple);
+                            continue;
+                        } catch (const MemoryBudgetExceeded&) {
+                            // at the last level, the partition is (mostly) one key; splitting it again would not help
+                            if (not spillable or level == max_spill_level) {
+                                throw;
                             }
                         }
                     }
+                    if constexpr (spillable) {
+                        if (not spilled) {
+                            spilled.emplace(memory, level);
+                            for (const auto& [key, rows]: table) {
+                                for (const auto& row: rows) {
+                                    spilled->add(Hash{}(key), row);
+                                }
+                            }
+                            Dict(&memory).swap(table);  // gives the memory back
+                        }
+                        spilled->add(Hash{}(key_of<build_left>(b_tuple)), b_tuple);
+                    }
                 }
-            } else {
-                S2Dict s2d;
-                for (auto&& r_tuple: r_input) {
-                    auto& v = s2d[t1_hj_projector(r_tuple)];
-                    v.emplace_back(r_tuple);
-                }
-                for (auto&& l_tuple: l_input) {
-                    const auto& l_key = t0_hj_projector(l_tuple);
-                    auto pos = s2d.find(l_key);
-                    if (pos != s2d.end()) {
-                        for (const auto& r_tuple: pos->second) {
-                            auto lr_tuple = std::tuple_cat(l_tuple, r_tuple);
-                            if (predicate(lr_tuple)) {
+            }
+            if (not spilled) {
+                for (auto&& p_tuple: probe_input) {
+                    if (level == 0) {
+                        count_input();
+                    }
+                    auto pos = table.find(key_of<not build_left>(p_tuple));
+                    if (pos != table.end()) {
+                        for (const auto& b_tuple: pos->second) {
+                            auto lr_tuple = joined<build_left>(b_tuple, p_tuple);
+                            if (predicate(lr_tuple, params...)) {
                                 co_yield lr_tuple;
                             }
                         }
                     }
                 }
-
+                co_return;
+            }
+            if constexpr (spillable) {
+                SpillPartitions<ProbeTuple<build_left>> probe_spilled(memory, level);
+                for (auto&& p_tuple: probe_input) {
+                    if (level == 0) {
+                        count_input();
+                    }
+                    // a row whose partition has no build rows would find no match
+                    auto key = key_of<not build_left>(p_tuple);
+                    if (not spilled->empty(spilled->partition(Hash{}(key)))) {
+                        probe_spilled.add(Hash{}(key), p_tuple);
+                    }
+                }
+                for (std::size_t p = 0; p < spill_fan_out; ++p) {
+                    if (not spilled->empty(p) and not probe_spilled.empty(p)) {
+                        auto b_rows = spilled->rows(p);
+                        auto p_rows = probe_spilled.rows(p);
+                        co_yield std::ranges::elements_of(hash_join<build_left>(b_rows, p_rows, memory, level + 1, params...));
+                    }
+                    spilled->drop(p);
+                    probe_spilled.drop(p);
+                }
             }
         }
     };
@@ -167,22 +381,20 @@ namespace impl {
         static_assert(not std::is_void_v<S1> and not std::is_void_v<S2>);
         static constexpr auto dnf_join_inner_dim = impl::make_inner_dim<QPI::res.join_condition.size()>(QPI::res.join_condition);
         static constexpr auto aligned_join_dnf = impl::align_dnf<dnf_join_inner_dim>(QPI::res.join_condition);
-        static constexpr std::optional dnf_join_selector = aligned_join_dnf.empty() ? std::nullopt : std::optional{impl::make_dnf_selector<S1, S2, false,
-                impl::make_indices_2d<S1, S2, true, false, dnf_join_inner_dim>(aligned_join_dnf),
-                impl::make_indices_2d<S1, S2, false, false, dnf_join_inner_dim>(aligned_join_dnf),
-                impl::make_cop_list_2d<dnf_join_inner_dim>(aligned_join_dnf), impl::make_rhs_type_list_2d<dnf_join_inner_dim>(aligned_join_dnf), dnf_join_inner_dim>(aligned_join_dnf)};
+        using JoinAtoms = impl::AtomTable<S1, S2, false, aligned_join_dnf, dnf_join_inner_dim>;
+        static constexpr std::optional dnf_join_selector = aligned_join_dnf.empty() ? std::nullopt : std::optional{impl::make_dnf_selector<JoinAtoms>()};
 
         // two-tuple selector from where conditions
         static constexpr std::optional where_two_tuple_selector = QPI::where_two_tuple_selector;
 
         // handles join & where conditions
-        static inline constexpr bool predicate(const auto& lr_tuple) {
+        static inline constexpr bool predicate(const auto& lr_tuple, const auto&... params) {
             if constexpr (dnf_join_selector and where_two_tuple_selector) {
-                return dnf_join_selector.value()(lr_tuple) and where_two_tuple_selector.value()(lr_tuple);
+                return dnf_join_selector.value()(lr_tuple) and where_two_tuple_selector.value()(lr_tuple, params...);
             } else if constexpr (dnf_join_selector) {
                 return dnf_join_selector.value()(lr_tuple);
             } else if constexpr (where_two_tuple_selector) {
-                return where_two_tuple_selector.value()(lr_tuple);
+                return where_two_tuple_selector.value()(lr_tuple, params...);
             } else {  // no 2-tuple filter at all
                 return true;
             }
@@ -193,21 +405,25 @@ namespace impl {
 
         // making the assumption that if a range is sized, it can be iterated for multiple times
         static std::generator<SchemaTuple2<S1, S2>> join(std::ranges::range auto& l_input, std::ranges::range auto& r_input,
-                                                         std::size_t l_estimated_size, std::size_t r_estimated_size) {
+                                                         std::size_t l_estimated_size, std::size_t r_estimated_size, const auto&... params) {
             if constexpr (is_materialized<decltype(l_input)>) {
+                count_input(std::ranges::size(l_input));
                 for (const auto& r_tuple: r_input) {  // one-pass through r-input
+                    count_input();
                     for (const auto& l_tuple: l_input) {
                         auto lr_tuple = std::tuple_cat(l_tuple, r_tuple);
-                        if (predicate(lr_tuple)) {
+                        if (predicate(lr_tuple, params...)) {
                             co_yield lr_tuple;
                         }
                     }
                 }
             } else if constexpr (is_materialized<decltype(r_input)>) {
+                count_input(std::ranges::size(r_input));
                 for (const auto& l_tuple: l_input) {  // one-pass through l-input
+                    count_input();
                     for (const auto &r_tuple: r_input) {
                         auto lr_tuple = std::tuple_cat(l_tuple, r_tuple);
-                        if (predicate(lr_tuple)) {
+                        if (predicate(lr_tuple, params...)) {
                             co_yield lr_tuple;
                         }
                     }
@@ -215,18 +431,19 @@ namespace impl {
             } else {  // neither is materialized; materialize the smaller one
                 const auto l_size = get_input_size(l_input, l_estimated_size);
                 const auto r_size = get_input_size(r_input, r_estimated_size);
+                OperatorMemory memory("nested loop join");
                 if (l_size <= r_size) {
-                    std::vector<std::ranges::range_value_t<decltype(l_input)>> materialized_input;
+                    std::pmr::vector<std::ranges::range_value_t<decltype(l_input)>> materialized_input(&memory);
                     for (auto&& l_tuple: l_input) {
                         materialized_input.emplace_back(l_tuple);
                     }
-                    co_yield std::ranges::elements_of(join(materialized_input, r_input, l_estimated_size, r_estimated_size));
+                    co_yield std::ranges::elements_of(join(materialized_input, r_input, l_estimated_size, r_estimated_size, params...));
                 } else {
-                    std::vector<std::ranges::range_value_t<decltype(r_input)>> materialized_input;
+                    std::pmr::vector<std::ranges::range_value_t<decltype(r_input)>> materialized_input(&memory);
                     for (auto&& r_tuple: r_input) {
                         materialized_input.emplace_back(r_tuple);
                     }
-                    co_yield std::ranges::elements_of(join(l_input, materialized_input, l_estimated_size, r_estimated_size));
+                    co_yield std::ranges::elements_of(join(l_input, materialized_input, l_estimated_size, r_estimated_size, params...));
                 }
             }
         }
@@ -242,37 +459,119 @@ namespace impl {
 
         static_assert(QP::res.group_by_keys.size() != 0);
 
-        static constexpr std::array group_by_indices = []() {
-            std::array<std::size_t, QP::res.group_by_keys.size()> gb_indices;
-            for (size_t i = 0; i < gb_indices.size(); ++i) {
-                gb_indices[i] = get_index<typename QP::S1Type, typename QP::S2Type>(QP::res.group_by_keys[i]);
-            }
-            return gb_indices;
-        }();
+        static constexpr std::array group_by_indices = make_group_by_indices<typename QP::S1Type, typename QP::S2Type, QP::res.group_by_keys.size()>(QP::res);
 
         using STuple = typename QP::STuple;
         using PTuple = typename QP::PTuple;
         static constexpr auto gb_projector = impl::make_projector<group_by_indices>();
         using GBTuple = ProjectedTuple<STuple, group_by_indices>;
-        using GBDict = std::unordered_map<GBTuple, PTuple, hash_tuple::hash<GBTuple>>;
+        using GBDict = std::pmr::unordered_map<GBTuple, PTuple, hash_tuple::hash<GBTuple>>;
+        using Spilled = std::pair<GBTuple, PTuple>;  // a row of a group that did not fit in memory
+
+        // the split of rows read back from disk; one type for every level, which bounds the instantiations of hash_reduce
+        static constexpr auto unspill = [](Spilled& row) -> Spilled&& { return std::move(row); };
 
         static std::generator<PTuple> reduce(std::ranges::range auto& input) {
+            OperatorMemory memory("hash aggregate");
+            co_yield std::ranges::elements_of(hash_reduce(input, memory, 0, [](const auto& inp_tuple) {
+                return std::make_pair(gb_projector(inp_tuple), projector(inp_tuple));
+            }));
+        }
+
+        // the groups of a hash aggregate, filled one row at a time. a group that no longer fits in the memory budget is
+        // not started; its rows go to disk, partitioned on the group-by keys, as pairs of key and projected row. the
+        // groups in memory are complete once the input is, and each partition is reduced the same way afterwards
+        class GroupTable {
+        public:
+            GroupTable(OperatorMemory& memory, std::size_t level): memory{memory}, level{level}, gb_dict(&memory) {}
+
+            void add(GBTuple gb_tuple, PTuple p_tuple) {
+                auto pos = gb_dict.find(gb_tuple);
+                if (pos == gb_dict.end()) {
+                    if (not spilled) {
+                        try {
+                            pos = gb_dict.emplace(gb_tuple, make_tuple_reduction_base<PTuple, QP::agg_ops>()).first;
+                            reduce_op = to_tuple_operator<QP::agg_ops>();  // reset
+                        } catch (const MemoryBudgetExceeded&) {
+                            if (not spillable or level == max_spill_level) {
+                                throw;
+                            }
+                        }
+                    }
+                    if constexpr (spillable) {
+                        if (pos == gb_dict.end()) {  // the group did not fit, now or earlier
+                            if (not spilled) {
+                                spilled.emplace(memory, level);
+                            }
+                            spilled->add(hash_tuple::hash<GBTuple>{}(gb_tuple), Spilled(std::move(gb_tuple), std::move(p_tuple)));
+                            return;
+                        }
+                    }
+                }
+                reduce_op(pos->second, p_tuple);
+            }
+
+            // the reduced groups, once every row is added; the table is emptied
+            std::generator<PTuple> results() {
+                for (const auto& kv: gb_dict) {
+                    co_yield kv.second;
+                }
+                if constexpr (spillable) {
+                    if (spilled) {
+                        GBDict(&memory).swap(gb_dict);  // gives the memory back
+                        for (std::size_t p = 0; p < spill_fan_out; ++p) {
+                            if (not spilled->empty(p)) {
+                                auto rows = spilled->rows(p);
+                                co_yield std::ranges::elements_of(hash_reduce(rows, memory, level + 1, unspill));
+                                spilled->drop(p);
+                            }
+                        }
+                    }
+                }
+            }
+
+        private:
+            static constexpr bool spillable = Spillable<Spilled>;  // see Join<true>::hash_join
+
+            OperatorMemory& memory;
+            std::size_t level;
             GBDict gb_dict;
+            std::optional<SpillPartitionsOf<Spilled>> spilled;
             std::function<void(PTuple&, const PTuple&)> reduce_op = to_tuple_operator<QP::agg_ops>();
+        };
+
+        // split maps an input row to a pair of group-by key and projected row
+        static std::generator<PTuple> hash_reduce(std::ranges::range auto& input, OperatorMemory& memory, std::size_t level, auto split) {
+            GroupTable groups(memory, level);
+            for (auto&& inp_tuple: input) {
+                auto [gb_tuple, p_tuple] = split(inp_tuple);
+                groups.add(std::move(gb_tuple), std::move(p_tuple));
+            }
+            co_yield std::ranges::elements_of(groups.results());
+        }
+
+        // input clustered on the group-by keys: one group is open at a time and is emitted once its key changes
+        static std::generator<PTuple> reduce_runs(std::ranges::range auto& input) {
+            struct Run {
+                GBTuple key;
+                PTuple acc;
+                decltype(to_tuple_operator<QP::agg_ops>()) reduce_op;
+            };
+            std::optional<Run> run;
             for (auto&& inp_tuple: input) {
                 auto gb_tuple = gb_projector(inp_tuple);
-                auto pos = gb_dict.find(gb_tuple);
-                if (pos == gb_dict.end()) {
-                    reduce_op = to_tuple_operator<QP::agg_ops>();  // reset
-                    pos = gb_dict.emplace(gb_tuple, make_tuple_reduction_base<PTuple, QP::agg_ops>()).first;
+                if (not run or run->key != gb_tuple) {
+                    if (run) {
+                        co_yield std::move(run->acc);
+                    }
+                    run.emplace(std::move(gb_tuple), make_tuple_reduction_base<PTuple, QP::agg_ops>(), to_tuple_operator<QP::agg_ops>());
                 }
-                reduce_op(pos->second, projector(inp_tuple));
+                run->reduce_op(run->acc, projector(inp_tuple));
             }
-            for (const auto& kv: gb_dict) {
-                co_yield kv.second;
+            if (run) {
+                co_yield std::move(run->acc);
             }
         }
-
     };
 
     // global reduce
@@ -291,6 +590,11 @@ namespace impl {
             }
             co_yield base;
         }
+
+        // a single group is trivially clustered
+        static std::generator<PTuple> reduce_runs(std::ranges::range auto& input) {
+            co_yield std::ranges::elements_of(reduce(input));
+        }
     };
 
     template<bool need_reduce, bool need_group_by, typename QP>
@@ -349,20 +653,17 @@ struct QueryPlannerImpl<false, QP> {
     //      after the push-down, we still need to filter the joined tuple according to the mixed-selector to ensure correctness
     // if both t0 and t1 are empty, meaning that push-down is impossible, we abandon the CNF entirely and use the original DNF
 
-    static constexpr std::optional t0_selector = t0.empty() ? std::nullopt : std::optional{impl::make_cnf_selector<S1, void, true,
-                    impl::make_indices_2d<S1, void, true, true, t0_inner_dim>(t0),
-                    impl::make_indices_2d<S1, void, false, true, t0_inner_dim>(t0),  // just a placeholder, rhs_indices not used
-                    impl::make_cop_list_2d<t0_inner_dim>(t0), impl::make_rhs_type_list_2d<t0_inner_dim>(t0), t0_inner_dim>(t0)};
-
-    static constexpr std::optional t1_selector = t1.empty() ? std::nullopt : std::optional{impl::make_cnf_selector<S2, void, true,
-                    impl::make_indices_2d<S2, void, true, true, t1_inner_dim>(t1),
-                    impl::make_indices_2d<S2, void, false, true, t1_inner_dim>(t1),
-                    impl::make_cop_list_2d<t1_inner_dim>(t1), impl::make_rhs_type_list_2d<t1_inner_dim>(t1), t1_inner_dim>(t1)};
+    // each selector evaluates its distinct atoms once per tuple; see impl::AtomTable
+    using T0Atoms = impl::AtomTable<S1, void, true, t0, t0_inner_dim>;
+    using T1Atoms = impl::AtomTable<S2, void, true, t1, t1_inner_dim>;
+    using MixedAtoms = impl::AtomTable<S1, S2, true, mixed, mixed_inner_dim>;
+    static constexpr std::optional t0_selector = t0.empty() ? std::nullopt : std::optional{impl::make_cnf_selector<T0Atoms>()};
+    static constexpr std::optional t1_selector = t1.empty() ? std::nullopt : std::optional{impl::make_cnf_selector<T1Atoms>()};
+    // CNF sources for the access paths of the two base tables
+    struct T0CNF { static constexpr const auto& cnf = t0; static constexpr const auto& inner_dim = t0_inner_dim; };
+    struct T1CNF { static constexpr const auto& cnf = t1; static constexpr const auto& inner_dim = t1_inner_dim; };
 
-    static constexpr std::optional mixed_selector = mixed.empty() ? std::nullopt : std::optional{impl::make_cnf_selector<S1, S2, true,
-                    impl::make_indices_2d<S1, S2, true, true, mixed_inner_dim>(mixed),
-                    impl::make_indices_2d<S1, S2, false, true, mixed_inner_dim>(mixed),
-                    impl::make_cop_list_2d<mixed_inner_dim>(mixed), impl::make_rhs_type_list_2d<mixed_inner_dim>(mixed), mixed_inner_dim>(mixed)};
+    static constexpr std::optional mixed_selector = mixed.empty() ? std::nullopt : std::optional{impl::make_cnf_selector<MixedAtoms>()};
 
     static constexpr bool use_push_down = t0_selector or t1_selector;
 
@@ -399,12 +700,235 @@ struct QueryPlannerImpl<false, QP> {
     }();
 
     using Join = impl::Join<admits_eq_join, QueryPlannerImpl>;
+
+    template<typename L, typename R>
+    static constexpr impl::IndexJoinSide index_join_side = []() {
+        if constexpr (admits_eq_join) { return Join::template index_join_side<L, R>(); }
+        else { return impl::IndexJoinSide::NONE; }
+    }();
 };
 
+namespace impl {
+    // the rewritten statement together with the facts read straight off it, produced by a single constant evaluation;
+    // members of QueryPlanner refer into it rather than re-walking the statement
+    struct PlanDescriptor {
+        Query query;
+        std::size_t num_params = 0;
+    };
+
+    template<Reflectable S1, Reflectable S2>
+    constexpr PlanDescriptor describe(const auto& cbuf) {
+        PlanDescriptor plan{number_params(resolve_table_name<S1, S2>(dealias_query(SelectParser::p.parse(cbuf).value())))};
+        plan.num_params = count_params(plan.query);
+        return plan;
+    }
+}
+
+namespace impl {
+    // the plan that process<QP> runs over inputs of types L (and R): which operators, in which order, with which
+    // predicates pushed down to which table. everything here is read off the planner's compile-time decisions
+    template<typename QP, typename L, typename R>
+    struct Explain {
+        using S1 = typename QP::S1Type;
+        using S2 = typename QP::S2Type;
+        static constexpr bool one_table = std::is_void_v<S2>;
+        static constexpr std::array<std::string_view, 2> tables = []() {
+            if constexpr (one_table) { return std::array<std::string_view, 2>{refl::reflect<S1>().name.str_view(), ""}; }
+            else { return std::array<std::string_view, 2>{refl::reflect<S1>().name.str_view(), refl::reflect<S2>().name.str_view()}; }
+        }();
+        static constexpr bool qualify = not one_table;
+
+        static constexpr ExplainText columns(const auto& cns) {
+            std::vector<ExplainText> names;
+            for (const auto& cn: cns) {
+                names.push_back(explain_output_column(cn, tables, qualify));
+            }
+            return explain_list(names);
+        }
+
+        static constexpr ExplainText clauses(std::size_t n) {
+            return explain_number(int64_t(n)) + (n == 1 ? " CNF clause" : " CNF clauses");
+        }
+
+        template<Reflectable S, typename Index>
+        static constexpr ExplainText index_columns() {
+            std::vector<ExplainText> names;
+            if constexpr (IsSortedIndex<Index>) {
+                names.emplace_back(member_list<S>[Index::key_index]);
+            } else {
+                for (std::size_t i: Index::key_indices) {
+                    names.emplace_back(member_list<S>[i]);
+                }
+            }
+            return explain_list(names);
+        }
+
+        // mirrors impl::scan; filter is the rendered selector of a full scan
+        template<Reflectable S, typename CNFSource, typename Input>
+        static constexpr ExplainNode scan(std::size_t table, const ExplainText& filter) {
+            constexpr AccessPath path = choose_access_path<S, CNFSource, Input>();
+            ExplainText detail(tables[table]);
+            if constexpr (path == AccessPath::FULL_SCAN) {
+                if (not filter.empty()) {
+                    detail += "; filter: " + filter;
+                }
+                return {"scan", detail, {}};
+            } else {
+                using Index = typename Input::IndexType;
+                if constexpr (path == AccessPath::ZONE_SCAN) {
+                    detail += "; zone map";
+                } else {
+                    detail += "; index on " + index_columns<S, Index>();
+                }
+                detail += "; " + clauses(CNFSource::cnf.size()) + ": " + explain_cnf(CNFSource::cnf, tables, qualify);
+                return {path == AccessPath::RANGE_SCAN ? "range scan" : path == AccessPath::POINT_LOOKUP ? "point lookup" : "zone scan", detail, {}};
+            }
+        }
+
+        template<typename QPI, std::size_t table>
+        static constexpr ExplainNode pushed_down_scan() {
+            if constexpr (table == 0 and QPI::t0_selector) {
+                return scan<S1, typename QPI::T0CNF, L>(0, explain_cnf(QPI::t0, tables, qualify));
+            } else if constexpr (table == 1 and QPI::t1_selector) {
+                return scan<S2, typename QPI::T1CNF, R>(1, explain_cnf(QPI::t1, tables, qualify));
+            } else {
+                return {"scan", ExplainText(tables[table]), {}};
+            }
+        }
+
+        // the WHERE clause of a join: CNF clauses local to one table are pushed below the join, the rest (or, if
+        // nothing can be pushed down, the original DNF) is checked on the joined tuples
+        template<typename QPI>
+        static constexpr ExplainText where_summary() {
+            if (QP::res.where_condition.empty()) {
+                return "";
+            }
+            ExplainText out = "where: " + clauses(QPI::num_cnf_clauses);
+            if constexpr (QPI::use_push_down) {
+                out += ", " + explain_number(int64_t(QPI::t0.size())) + " pushed to " + ExplainText(tables[0])
+                       + ", " + explain_number(int64_t(QPI::t1.size())) + " to " + ExplainText(tables[1]);
+                if constexpr (not QPI::mixed.empty()) {
+                    out += "; after the join: " + explain_cnf(QPI::mixed, tables, qualify);
+                }
+            } else {
+                out += ", none local to one table; after the join: " + explain_dnf(QP::res.where_condition, tables, qualify);
+            }
+            return out;
+        }
+
+        static constexpr ExplainNode join() {
+            using QPI = typename QP::QPI;
+            using Join = typename QPI::Join;
+            std::vector<ExplainText> details;
+            if constexpr (QPI::admits_eq_join) {
+                details.push_back(explain_list([]() {
+                    std::vector<ExplainText> eqs;
+                    for (const auto& bf: Join::eq_jc) {
+                        eqs.push_back(explain_factor(bf, tables, qualify));
+                    }
+                    return eqs;
+                }(), " AND "));
+                if constexpr (not Join::the_rest_jc.empty()) {
+                    std::vector<ExplainText> rest;
+                    for (const auto& bf: Join::the_rest_jc) {
+                        rest.push_back(explain_factor(bf, tables, qualify));
+                    }
+                    details.push_back("residual: " + explain_list(rest, " AND "));
+                }
+            } else if (not QP::res.join_condition.empty()) {
+                details.push_back("on " + explain_dnf(QP::res.join_condition, tables, qualify));
+            }
+            if (ExplainText where = where_summary<QPI>(); not where.empty()) {
+                details.push_back(where);
+            }
+
+            constexpr IndexJoinSide side = QPI::template index_join_side<L, R>;
+            if constexpr (side != IndexJoinSide::NONE) {
+                constexpr bool on_right = side == IndexJoinSide::RIGHT;
+                using Indexed = std::conditional_t<on_right, R, L>;
+                using S = std::conditional_t<on_right, S2, S1>;
+                details.push_back("probes the hash index on " + ExplainText(tables[on_right]) + "(" + index_columns<S, typename Indexed::IndexType>() + ")");
+                ExplainText indexed_detail(tables[on_right]);
+                if constexpr (on_right and QPI::t1_selector) {
+                    indexed_detail += "; filter: " + explain_cnf(QPI::t1, tables, qualify);
+                } else if constexpr (not on_right and QPI::t0_selector) {
+                    indexed_detail += "; filter: " + explain_cnf(QPI::t0, tables, qualify);
+                }
+                return {"index join", explain_list(details, "; "), {pushed_down_scan<QPI, on_right ? 0 : 1>(), {"index lookup", indexed_detail, {}}}};
+            } else if constexpr (QPI::admits_eq_join) {
+                details.push_back("build: the smaller input, by size or by the estimates passed to process");
+                return {"hash join", explain_list(details, "; "), {pushed_down_scan<QPI, 0>(), pushed_down_scan<QPI, 1>()}};
+            } else {
+                // see Join<false>::join; scanned inputs are generators and never count as materialized
+                constexpr bool l_materialized = not QPI::t0_selector and Join::template is_materialized<L&>;
+                constexpr bool r_materialized = not QPI::t1_selector and Join::template is_materialized<R&>;
+                if constexpr (l_materialized or r_materialized) {
+                    details.push_back("inner: " + ExplainText(tables[l_materialized ? 0 : 1]));
+                } else {
+                    details.push_back("inner: the smaller input, by size or by the estimates passed to process, materialized");
+                }
+                return {"nested loop join", explain_list(details, "; "), {pushed_down_scan<QPI, 0>(), pushed_down_scan<QPI, 1>()}};
+            }
+        }
+
+        static constexpr ExplainNode input() {
+            if constexpr (not one_table) {
+                return join();
+            } else if constexpr (QP::dnf_where_selector) {
+                return scan<S1, WhereCNF<QP>, L>(0, explain_dnf(QP::res.where_condition, tables, qualify));
+            } else {
+                return {"scan", ExplainText(tables[0]), {}};
+            }
+        }
+
+        static constexpr ExplainNode projected() {
+            if constexpr (QP::need_reduce or QP::projector) {
+                constexpr bool clustered_input = one_table and IsClusteredInput<L>;
+                ExplainText detail = columns(QP::res.cns);
+                if constexpr (not QP::res.group_by_keys.empty()) {
+                    detail = "group by " + columns(QP::res.group_by_keys) + "; " + detail;
+                }
+                return {ExplainText(QP::template reduce_project_name<clustered_input>), detail, {input()}};
+            } else {
+                return input();
+            }
+        }
+
+        static constexpr ExplainNode ordered() {
+            if constexpr (QP::has_order_by or QP::has_limit) {
+                std::vector<ExplainText> parts;
+                if constexpr (QP::has_order_by) {
+                    std::vector<ExplainText> keys;
+                    for (const auto& ok: QP::res.order_by) {
+                        keys.push_back(explain_output_column(ok.column, tables, qualify) + (ok.descending ? " DESC" : " ASC"));
+                    }
+                    parts.push_back(explain_list(keys));
+                }
+                if constexpr (QP::has_limit) {
+                    parts.push_back("limit " + explain_number(int64_t(QP::res.limit.value())));
+                }
+                return {ExplainText(QP::order_limit_name), explain_list(parts, "; "), {projected()}};
+            } else {
+                return projected();
+            }
+        }
+
+        static constexpr ExplainText render() {
+            ExplainText out;
+            ExplainNode{"query", ExplainText(QP::sql), {ordered()}}.render(out);
+            return out;
+        }
+    };
+}
+
 template<refl::const_string query_str, Reflectable S1, Reflectable S2=void>
 struct QueryPlanner {
+    static constexpr std::string_view sql{query_str.data};
+    static constexpr uint64_t query_id = impl::fingerprint(sql);  // names the query in profiles and traces
     static constexpr auto cbuf = ctpg::buffers::cstring_buffer(query_str.data);
-    static constexpr auto res = impl::resolve_table_name<S1, S2>(impl::dealias_query(SelectParser::p.parse(cbuf).value()));
+    static constexpr impl::PlanDescriptor plan = impl::describe<S1, S2>(cbuf);
+    static constexpr const Query& res = plan.query;  // this is the parsed SQL statement
+    static constexpr std::size_t num_params = plan.num_params;
 
     using S1Type = S1;
     using S2Type = S2;
@@ -412,9 +936,8 @@ struct QueryPlanner {
     static constexpr auto dnf_where_inner_dim = impl::make_inner_dim<res.where_condition.size()>(res.where_condition);
     static constexpr auto aligned_where_dnf = impl::align_dnf<dnf_where_inner_dim>(res.where_condition);
 
-    static constexpr std::optional dnf_where_selector = aligned_where_dnf.empty() ? std::nullopt : std::optional{impl::make_dnf_selector<S1, S2, true,
-            impl::make_indices_2d<S1, S2, true, true, dnf_where_inner_dim>(aligned_where_dnf), impl::make_indices_2d<S1, S2, false, true, dnf_where_inner_dim>(aligned_where_dnf),
-            impl::make_cop_list_2d<dnf_where_inner_dim>(aligned_where_dnf), impl::make_rhs_type_list_2d<dnf_where_inner_dim>(aligned_where_dnf), dnf_where_inner_dim>(aligned_where_dnf)};
+    using WhereAtoms = impl::AtomTable<S1, S2, true, aligned_where_dnf, dnf_where_inner_dim>;
+    static constexpr std::optional dnf_where_selector = aligned_where_dnf.empty() ? std::nullopt : std::optional{impl::make_dnf_selector<WhereAtoms>()};
 
     using QPI = QueryPlannerImpl<std::is_void_v<S2>, QueryPlanner>;
 
@@ -430,8 +953,16 @@ struct QueryPlanner {
     using Reduce = impl::Reduce<need_reduce, not res.group_by_keys.empty(), QueryPlanner>;
     using ResultType = std::conditional_t<projector.has_value(), PTuple, STuple>;
 
+    static constexpr bool has_order_by = not res.order_by.empty();
+    static constexpr bool has_limit = res.limit.has_value();
+    static constexpr auto order_indices_and_desc = impl::make_order_indices<S1, S2, res.order_by.size()>(res);
+    static constexpr auto order_comparator = impl::make_order_comparator<order_indices_and_desc.first, order_indices_and_desc.second>();
+
+    template<bool clustered_input=false>
     static std::generator<ResultType> reduce_project(std::ranges::range auto& input) {
-        if constexpr (need_reduce) {
+        if constexpr (need_reduce and clustered_input) {
+            co_yield std::ranges::elements_of(Reduce::RG::reduce_runs(input));
+        } else if constexpr (need_reduce) {
             auto reduced = Reduce::RG::reduce(input);
             co_yield std::ranges::elements_of(reduced);
         } else {  // only apply projector
@@ -445,39 +976,204 @@ struct QueryPlanner {
         }
     }
 
+    // ORDER BY and/or LIMIT on top of the (reduced &) projected tuples
+    static std::generator<ResultType> order_limit(std::ranges::range auto& input) {
+        if constexpr (has_order_by and has_limit) {
+            co_yield std::ranges::elements_of(impl::top_n<ResultType, order_comparator>(input, res.limit.value()));
+        } else if constexpr (has_order_by) {
+            co_yield std::ranges::elements_of(impl::sort_all<ResultType, order_indices_and_desc.first, order_indices_and_desc.second>(input));
+        } else if constexpr (has_limit) {
+            co_yield std::ranges::elements_of(impl::take<ResultType>(input, res.limit.value()));
+        } else {
+            co_yield std::ranges::elements_of(input);
+        }
+    }
+
+    // everything after filtering & joining
+    template<bool clustered_input=false>
+    static std::generator<ResultType> output(std::ranges::range auto& input) {
+        if constexpr (has_order_by or has_limit) {
+            auto projected = observed_reduce_project<clustered_input>(input);
+            co_yield std::ranges::elements_of(impl::instrument(order_limit_name, "", order_limit(projected)));
+        } else {
+            co_yield std::ranges::elements_of(observed_reduce_project<clustered_input>(input));
+        }
+    }
+
+    // operator names in profiles and in explain()
+    static constexpr std::string_view order_limit_name = has_order_by and has_limit ? "top n" : has_order_by ? "sort" : "limit";
+    // whether operators of the query keep rows in memory (see operator/memory.h): joins, which are over two tables,
+    // hash aggregates and sorts
+    template<bool clustered_input>
+    static constexpr bool holds_rows = not std::is_void_v<S2> or (need_reduce and not res.group_by_keys.empty() and not clustered_input)
+                                       or has_order_by;
+
+    template<bool clustered_input>
+    static constexpr std::string_view reduce_project_name = not need_reduce ? "project"
+                                                            : res.group_by_keys.empty() ? "aggregate"
+                                                            : clustered_input ? "stream aggregate" : "hash aggregate";
+
+    // the plan process<QueryPlanner> runs over inputs of the given types (plain vectors if none are given), as an
+    // indented tree: e.g. QP::explain<decltype(l_input), decltype(r_input)>(). computed at compile time
+    template<typename... Inputs>
+    static constexpr std::string_view explain() {
+        static_assert(sizeof...(Inputs) == 0 or sizeof...(Inputs) == (std::is_void_v<S2> ? 1 : 2), "one input type per table");
+        using Defaults = std::tuple<std::vector<SchemaTuple<S1>>, std::conditional_t<std::is_void_v<S2>, void, std::vector<STuple>>>;
+        using Given = std::conditional_t<sizeof...(Inputs) == 0, Defaults, std::tuple<std::remove_cvref_t<Inputs>..., void>>;
+        using Plan = impl::Explain<QueryPlanner, std::tuple_element_t<0, Given>, std::tuple_element_t<1, Given>>;
+        return {explain_text<Plan>.data(), explain_text<Plan>.size()};
+    }
+
+    template<typename Plan>
+    static constexpr auto explain_text = impl::explain_chars<&Plan::render>();
+
+    template<bool clustered_input>
+    static auto observed_reduce_project(std::ranges::range auto& input) {
+        if constexpr (need_reduce or projector) {
+            return impl::instrument(reduce_project_name<clustered_input>, "", reduce_project<clustered_input>(input));
+        } else {
+            return reduce_project<clustered_input>(input);
+        }
+    }
 };
 
-template<typename QP> requires requires { std::is_void_v<typename QP::S2Type>; }
-std::generator<typename QP::ResultType> process(std::ranges::range auto& input) {
+// a query with placeholders also takes their values: process<QP>(input, bind_params(...))
+template<typename QP> requires std::is_void_v<typename QP::S2Type>
+std::generator<typename QP::ResultType> process(std::ranges::range auto& input, impl::IsParams auto... bound) {
+    impl::check_params<QP, decltype(bound)...>();
+    // filtering keeps the input order, so clustering on the group-by keys survives the scan
+    constexpr bool clustered_input = impl::IsClusteredInput<decltype(input)>;
     if constexpr (QP::dnf_where_selector) {
-        auto filtered = filter<QP::dnf_where_selector.value()>(input);
-        co_yield std::ranges::elements_of(QP::reduce_project(filtered));
+        auto filtered = impl::scan<typename QP::S1Type, impl::WhereCNF<QP>, QP::dnf_where_selector.value()>(input, bound.values...);
+        co_yield std::ranges::elements_of(impl::account_memory<QP::template holds_rows<clustered_input>>(QP::sql,
+                impl::instrument("query", QP::sql, QP::template output<clustered_input>(filtered), impl::known_size(input), QP::query_id)));
     } else {
-        co_yield std::ranges::elements_of(QP::reduce_project(input));
+        co_yield std::ranges::elements_of(impl::account_memory<QP::template holds_rows<clustered_input>>(QP::sql,
+                impl::instrument("query", QP::sql, QP::template output<clustered_input>(input), impl::known_size(input), QP::query_id)));
+    }
+}
+
+// one scan answering a prepared query under many bindings; the i-th stream is the result under bindings[i]. each binding
+// folds the rows it matches as the scan goes (see operator/fold.h); together they are one query to the memory budget
+template<typename QP, typename... Ts> requires std::is_void_v<typename QP::S2Type>
+std::vector<std::generator<typename QP::ResultType>> process_batch(std::ranges::range auto& input, const std::vector<Params<Ts...>>& bindings) {
+    static_assert(QP::num_params > 0, "batching only applies to queries with placeholders");
+    impl::check_params<QP, Params<Ts...>>();
+    auto query = std::make_shared<impl::QueryMemory>(QP::sql, memory_budget());
+    impl::last_query = query;
+    std::vector<std::unique_ptr<impl::QueryFold<QP>>> folds;
+    folds.reserve(bindings.size());
+    for (std::size_t i = 0; i < bindings.size(); ++i) {
+        folds.push_back(std::make_unique<impl::QueryFold<QP>>(query));
     }
+    impl::BatchScan<QP, Params<Ts...>>::route(input, bindings, folds);
+    std::vector<std::generator<typename QP::ResultType>> results;
+    results.reserve(bindings.size());
+    for (auto& fold: folds) {
+        results.push_back(impl::QueryFold<QP>::results(std::move(fold)));
+    }
+    return results;
 }
 
-template<typename QP> requires requires { not std::is_void_v<typename QP::S2Type>; }
+// several queries over the same table in one pass; the i-th stream is the result of the i-th query. each query folds
+// the rows it keeps as the pass goes (see operator/fold.h), and holds its groups or projected rows until read; together
+// they are one query to the memory budget
+template<typename... QPs> requires (sizeof...(QPs) > 0)
+std::tuple<std::generator<typename QPs::ResultType>...> process_many(std::ranges::range auto& input) {
+    static const std::string sql = [] {
+        std::string joined;
+        ((joined += joined.empty() ? "" : "; ", joined += QPs::sql), ...);
+        return joined;
+    }();
+    auto query = std::make_shared<impl::QueryMemory>(sql, memory_budget());
+    impl::last_query = query;
+    std::tuple<std::unique_ptr<impl::QueryFold<QPs>>...> folds{std::make_unique<impl::QueryFold<QPs>>(query)...};  // in order
+    impl::SharedScan<QPs...>::route(input, folds);
+    return [&]<std::size_t... Q>(std::index_sequence<Q...>) {
+        return std::make_tuple(impl::QueryFold<QPs>::results(std::move(std::get<Q>(folds)))...);
+    }(std::index_sequence_for<QPs...>());
+}
+
+// a single-table query over a constexpr std::array (of schema objects or schema tuples), answered at compile time;
+// the result is a std::array sized to the number of result rows. its columns must not own heap memory (see
+// impl::is_constant_row): select numbers or std::string_view columns, not std::string ones
+template<typename QP, const auto& input> requires std::is_void_v<typename QP::S2Type>
+consteval auto constexpr_process() {
+    static_assert(QP::num_params == 0, "placeholders cannot be bound in constant evaluation");
+    static_assert(impl::is_constant_row<typename QP::ResultType>::value,
+                  "the result columns of constexpr_process must be numbers, enums or string views: a std::string cannot outlive constant evaluation");
+    return impl::ConstantEval<QP, input>::result();
+}
+
+// per-window aggregates of a single-table query over an input ordered by the window's timestamp column.
+// each window is yielded once it closes, so this also works over unbounded generators
+template<typename QP, impl::IsWindow W> requires std::is_void_v<typename QP::S2Type>
+std::generator<typename impl::WindowAggregate<QP, W>::WindowRow> process(std::ranges::range auto& input) {
+    static_assert(QP::need_reduce, "windows only apply to aggregate queries");
+    static_assert(not QP::has_order_by, "ORDER BY over a stream of windows is not supported");
+    using WA = impl::WindowAggregate<QP, W>;
+    auto filtered = [&input]() {
+        if constexpr (QP::dnf_where_selector) {
+            return impl::scan<typename QP::S1Type, impl::WhereCNF<QP>, QP::dnf_where_selector.value()>(input);
+        } else {
+            return std::ranges::ref_view(input);
+        }
+    }();
+    auto windows = WA::aggregate(filtered);
+    if constexpr (QP::has_limit) {
+        co_yield std::ranges::elements_of(impl::take<typename WA::WindowRow>(windows, QP::res.limit.value()));
+    } else {
+        co_yield std::ranges::elements_of(windows);
+    }
+}
+
+namespace impl {
+    template<typename QP>
+    std::generator<typename QP::ResultType> process_two(std::ranges::range auto& l_input, std::ranges::range auto& r_input,
+                                                        std::size_t l_estimated_size, std::size_t r_estimated_size, const auto&... params) {
+        static constexpr std::string_view join_name = QP::QPI::admits_eq_join ? "hash join" : "nested loop join";
+        // a side with a matching hash index turns the equi-join into an index nested-loop join
+        if constexpr (QP::QPI::template index_join_side<std::remove_cvref_t<decltype(l_input)>, std::remove_cvref_t<decltype(r_input)>> != impl::IndexJoinSide::NONE) {
+            auto joined = instrument("index join", "", QP::QPI::Join::index_join(l_input, r_input, params...));
+            co_yield std::ranges::elements_of(QP::output(joined));
+        }
+        // this is clumsy, but it preserves the materialized-ness of the input
+        else if constexpr (QP::QPI::t0_selector and QP::QPI::t1_selector) {
+            auto l_filtered = impl::scan<typename QP::S1Type, typename QP::QPI::T0CNF, QP::QPI::t0_selector.value()>(l_input, params...);
+            auto r_filtered = impl::scan<typename QP::S2Type, typename QP::QPI::T1CNF, QP::QPI::t1_selector.value()>(r_input, params...);
+            auto joined = instrument(join_name, "", QP::QPI::Join::join(l_filtered, r_filtered, l_estimated_size, r_estimated_size, params...));
+            co_yield std::ranges::elements_of(QP::output(joined));
+        } else if constexpr (QP::QPI::t0_selector) {
+            auto l_filtered = impl::scan<typename QP::S1Type, typename QP::QPI::T0CNF, QP::QPI::t0_selector.value()>(l_input, params...);
+            auto joined = instrument(join_name, "", QP::QPI::Join::join(l_filtered, r_input, l_estimated_size, r_estimated_size, params...));
+            co_yield std::ranges::elements_of(QP::output(joined));
+        } else if constexpr (QP::QPI::t1_selector) {
+            auto r_filtered = impl::scan<typename QP::S2Type, typename QP::QPI::T1CNF, QP::QPI::t1_selector.value()>(r_input, params...);
+            auto joined = instrument(join_name, "", QP::QPI::Join::join(l_input, r_filtered, l_estimated_size, r_estimated_size, params...));
+            co_yield std::ranges::elements_of(QP::output(joined));
+        } else {  // we do not use push-down at all
+            auto joined = instrument(join_name, "", QP::QPI::Join::join(l_input, r_input, l_estimated_size, r_estimated_size, params...));
+            co_yield std::ranges::elements_of(QP::output(joined));
+        }
+    }
+}
+
+template<typename QP> requires (not std::is_void_v<typename QP::S2Type>)
 std::generator<typename QP::ResultType> process(std::ranges::range auto& l_input, std::ranges::range auto& r_input,
                                                 std::size_t l_estimated_size=0, std::size_t r_estimated_size=1) {
-    // this is clumsy, but it preserves the materialized-ness of the input
-    if constexpr (QP::QPI::t0_selector and QP::QPI::t1_selector) {
-        auto l_filtered = filter<QP::QPI::t0_selector.value()>(l_input);
-        auto r_filtered = filter<QP::QPI::t1_selector.value()>(r_input);
-        auto joined = QP::QPI::Join::join(l_filtered, r_filtered, l_estimated_size, r_estimated_size);
-        co_yield std::ranges::elements_of(QP::reduce_project(joined));
-    } else if constexpr (QP::QPI::t0_selector) {
-        auto l_filtered = filter<QP::QPI::t0_selector.value()>(l_input);
-        auto joined = QP::QPI::Join::join(l_filtered, r_input, l_estimated_size, r_estimated_size);
-        co_yield std::ranges::elements_of(QP::reduce_project(joined));
-    } else if constexpr (QP::QPI::t1_selector) {
-        auto r_filtered = filter<QP::QPI::t1_selector.value()>(r_input);
-        auto joined = QP::QPI::Join::join(l_input, r_filtered, l_estimated_size, r_estimated_size);
-        co_yield std::ranges::elements_of(QP::reduce_project(joined));
-    } else {  // we do not use push-down at all
-        auto joined = QP::QPI::Join::join(l_input, r_input, l_estimated_size, r_estimated_size);
-        co_yield std::ranges::elements_of(QP::reduce_project(joined));
-    }
+    impl::check_params<QP>();
+    co_yield std::ranges::elements_of(impl::account_memory<QP::template holds_rows<false>>(QP::sql,
+            impl::instrument("query", QP::sql, impl::process_two<QP>(l_input, r_input, l_estimated_size, r_estimated_size),
+                             impl::known_size(l_input, r_input), QP::query_id)));
+}
+
+template<typename QP> requires (not std::is_void_v<typename QP::S2Type>)
+std::generator<typename QP::ResultType> process(std::ranges::range auto& l_input, std::ranges::range auto& r_input, impl::IsParams auto bound,
+                                                std::size_t l_estimated_size=0, std::size_t r_estimated_size=1) {
+    impl::check_params<QP, decltype(bound)>();
+    co_yield std::ranges::elements_of(impl::account_memory<QP::template holds_rows<false>>(QP::sql,
+            impl::instrument("query", QP::sql, impl::process_two<QP>(l_input, r_input, l_estimated_size, r_estimated_size, bound.values),
+                             impl::known_size(l_input, r_input), QP::query_id)));
 }
 
 }
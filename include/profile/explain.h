@@ -0,0 +1,228 @@
+#ifndef SQL_EXPLAIN_H
+#define SQL_EXPLAIN_H
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+#include "common.h"
+
+// building blocks of QueryPlanner::explain: a plan tree of operator names and details, rendered to text during
+// constant evaluation. the operator names are the ones that profiles (profile/instrument.h) use, so an EXPLAIN can be
+// laid next to the EXPLAIN ANALYZE of the same query
+
+namespace ctsql {
+namespace impl {
+    // text built during constant evaluation. GCC 12 rejects many uses of short std::string temporaries in constant
+    // expressions (moves out of the small-string buffer), so the characters are kept in a vector instead. it also
+    // destroys class temporaries twice when they are the result of ?:, so no such expression here yields an ExplainText
+    class ExplainText {
+    public:
+        constexpr ExplainText() = default;
+        constexpr ExplainText(std::string_view s): chars(s.begin(), s.end()) {}
+        constexpr ExplainText(const char* s): ExplainText(std::string_view(s)) {}
+
+        constexpr ExplainText& operator+=(std::string_view s) {
+            chars.insert(chars.end(), s.begin(), s.end());
+            return *this;
+        }
+        constexpr ExplainText& operator+=(const char* s) {
+            return *this += std::string_view(s);
+        }
+        constexpr ExplainText& operator+=(const ExplainText& t) {
+            chars.insert(chars.end(), t.chars.begin(), t.chars.end());
+            return *this;
+        }
+        // both sides by reference: GCC 12 mishandles returning a by-value parameter in constant evaluation
+        friend constexpr ExplainText operator+(const ExplainText& lhs, const ExplainText& rhs) {
+            ExplainText out = lhs;
+            out += rhs;
+            return out;
+        }
+
+        constexpr std::string_view view() const { return {chars.data(), chars.size()}; }
+        constexpr std::size_t size() const { return chars.size(); }
+        constexpr bool empty() const { return chars.empty(); }
+        constexpr bool operator==(std::string_view s) const { return view() == s; }
+
+    private:
+        std::vector<char> chars;
+    };
+
+    struct ExplainNode {
+        ExplainText name;
+        ExplainText detail;
+        std::vector<ExplainNode> children;
+
+        // same layout as PlanNode::print, minus the statistics
+        constexpr void render(ExplainText& out, const ExplainText& indent = {}, bool last = true, bool root = true) const {
+            out += indent;
+            out += root ? "" : last ? "└─ " : "├─ ";
+            out += name;
+            if (not detail.empty()) {
+                out += " [" + detail + "]";
+            }
+            out += "\n";
+            const ExplainText child_indent = indent + (root ? "" : last ? "   " : "│  ");
+            for (std::size_t i = 0; i < children.size(); ++i) {
+                children[i].render(out, child_indent, i + 1 == children.size(), false);
+            }
+        }
+    };
+
+    constexpr ExplainText explain_number(int64_t v) {
+        if (v == 0) {
+            return "0";
+        }
+        char digits[24]{};
+        std::size_t n = sizeof(digits);
+        const bool negative = v < 0;
+        uint64_t u = negative ? uint64_t(0) - static_cast<uint64_t>(v) : static_cast<uint64_t>(v);
+        while (u != 0) {
+            digits[--n] = static_cast<char>('0' + u % 10);
+            u /= 10;
+        }
+        if (negative) {
+            digits[--n] = '-';
+        }
+        return std::string_view(digits + n, sizeof(digits) - n);
+    }
+
+    // fixed-point with at most 6 decimals, or past 1e18 a mantissa and a power of ten; enough to recognize the literal
+    // of the query. the integral and decimal parts are converted apart, as v * 10^6 may not fit an int64_t
+    constexpr ExplainText explain_number(double v) {
+        if (v != v) {
+            return "nan";
+        }
+        const bool negative = v < 0;
+        if (negative) {
+            v = -v;
+        }
+        ExplainText out = negative ? "-" : "";
+        if (v - v != 0) {
+            return out + "inf";
+        }
+        if (v >= 1e18) {
+            int64_t exponent = 0;
+            for (; v >= 10; v /= 10) {
+                ++exponent;
+            }
+            return out + explain_number(v) + "e" + explain_number(exponent);
+        }
+        constexpr int64_t scale = 1'000'000;
+        auto whole = static_cast<int64_t>(v);
+        auto frac = static_cast<int64_t>((v - static_cast<double>(whole)) * scale + 0.5);
+        if (frac == scale) {
+            ++whole;
+            frac = 0;
+        }
+        out += explain_number(whole);
+        if (frac != 0) {
+            char decimals[6]{};
+            for (std::size_t i = sizeof(decimals); i-- > 0; frac /= 10) {
+                decimals[i] = static_cast<char>('0' + frac % 10);
+            }
+            std::size_t n = sizeof(decimals);
+            while (decimals[n - 1] == '0') {
+                --n;
+            }
+            out += ".";
+            out += std::string_view(decimals, n);
+        }
+        return out;
+    }
+
+    // columns of resolved statements name their table by position ("0" or "1"); tables holds the schema names
+    constexpr ExplainText explain_column(const ColumnReference auto& c, const std::array<std::string_view, 2>& tables, bool qualify) {
+        ExplainText out;
+        if (qualify and (c.table_name == "0" or c.table_name == "1")) {
+            out += tables[c.table_name == "0" ? 0 : 1];
+            out += ".";
+        }
+        out += c.column_name.empty() ? std::string_view("*") : c.column_name;
+        return out;
+    }
+
+    constexpr ExplainText explain_output_column(const ColumnName& c, const std::array<std::string_view, 2>& tables, bool qualify) {
+        if (c.agg == AggOp::NONE) {
+            return explain_column(c, tables, qualify);
+        }
+        return ExplainText(to_str(c.agg)) + "(" + explain_column(c, tables, qualify) + ")";
+    }
+
+    template<bool one_side>
+    constexpr ExplainText explain_factor(const BooleanFactor<one_side>& bf, const std::array<std::string_view, 2>& tables, bool qualify) {
+        ExplainText out = explain_column(bf.lhs, tables, qualify);
+        out += " ";
+        out += to_str(bf.cop);
+        out += " ";
+        if constexpr (one_side) {
+            if (std::holds_alternative<std::string_view>(bf.rhs)) {
+                out += "'" + ExplainText(std::get<std::string_view>(bf.rhs)) + "'";
+            } else if (std::holds_alternative<int64_t>(bf.rhs)) {
+                out += explain_number(std::get<int64_t>(bf.rhs));
+            } else if (std::holds_alternative<double>(bf.rhs)) {
+                out += explain_number(std::get<double>(bf.rhs));
+            } else {
+                const auto& p = std::get<Param>(bf.rhs);
+                out += p.name.empty() ? "?" : ":";
+                out += p.name;
+            }
+        } else {
+            out += explain_column(bf.rhs, tables, qualify);
+        }
+        return out;
+    }
+
+    constexpr ExplainText explain_list(const std::vector<ExplainText>& items, std::string_view sep = ", ") {
+        ExplainText out;
+        for (std::size_t i = 0; i < items.size(); ++i) {
+            if (i) {
+                out += sep;
+            }
+            out += items[i];
+        }
+        return out;
+    }
+
+    // rows of mat joined by outer_sep, factors of a row by inner_sep; rows of several factors are parenthesized
+    // if there is more than one row. works for DNF (OR of ANDs) and CNF (AND of ORs) alike
+    constexpr ExplainText explain_conditions(const auto& mat, std::string_view outer_sep, std::string_view inner_sep,
+                                             const std::array<std::string_view, 2>& tables, bool qualify) {
+        std::vector<ExplainText> rows;
+        for (const auto& row: mat) {
+            std::vector<ExplainText> factors;
+            for (const auto& bf: row) {
+                factors.push_back(explain_factor(bf, tables, qualify));
+            }
+            if (mat.size() > 1 and row.size() > 1) {
+                rows.push_back("(" + explain_list(factors, inner_sep) + ")");
+            } else {
+                rows.push_back(explain_list(factors, inner_sep));
+            }
+        }
+        return explain_list(rows, outer_sep);
+    }
+
+    constexpr ExplainText explain_dnf(const auto& dnf, const std::array<std::string_view, 2>& tables, bool qualify) {
+        return explain_conditions(dnf, " OR ", " AND ", tables, qualify);
+    }
+
+    constexpr ExplainText explain_cnf(const auto& cnf, const std::array<std::string_view, 2>& tables, bool qualify) {
+        return explain_conditions(cnf, " AND ", " OR ", tables, qualify);
+    }
+
+    // the text made by render(), copied into storage that survives constant evaluation
+    template<auto render>
+    consteval auto explain_chars() {
+        constexpr std::size_t n = render().size();
+        std::array<char, n> chars{};
+        const ExplainText text = render();
+        std::ranges::copy(text.view(), chars.begin());
+        return chars;
+    }
+}
+}
+#endif //SQL_EXPLAIN_H
@@ -0,0 +1,322 @@
+#ifndef SQL_INSTRUMENT_H
+#define SQL_INSTRUMENT_H
+
+#include <__generator.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <new>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "profile/perf_counters.h"
+#include "profile/trace.h"
+
+// per-operator statistics of executed queries (EXPLAIN ANALYZE). compiled in with -DCTSQL_INSTRUMENT only; without
+// it every hook below folds away and the operators are exactly the uninstrumented ones.
+//
+// every operator of a query is wrapped so that the intervals in which it produces rows are timed. operators pull
+// from their inputs, so the nesting of those intervals is the plan tree: an operator that is first resumed while
+// another one is running becomes its child. time and bytes of a node include its children's; self_time()/self_bytes()
+// do not. bytes are only counted if one translation unit of the program expands CTSQL_COUNT_ALLOCATIONS().
+// -DCTSQL_PERF_COUNTERS (which implies CTSQL_INSTRUMENT) adds hardware event counts, see profile/perf_counters.h;
+// reading them costs a system call whenever the running operator changes, which shows in the times.
+//
+//   for (auto&& row: process<QP>(input)) { ... }
+//   std::cout << *ctsql::last_profile();
+
+#if (defined(CTSQL_PERF_COUNTERS) || defined(CTSQL_TRACE)) && !defined(CTSQL_INSTRUMENT)
+#define CTSQL_INSTRUMENT
+#endif
+
+namespace ctsql {
+    struct PlanNode {
+        std::string name;
+        std::string detail;
+        uint64_t query_id = 0;  // QueryPlanner::query_id of the query the operator belongs to
+        std::optional<std::size_t> rows_in;  // when the operator knows it; input_rows() falls back to the children
+        std::size_t rows_out = 0;
+        std::chrono::nanoseconds time{};
+        std::size_t bytes = 0;
+        std::optional<HardwareCounters> counters;  // with CTSQL_PERF_COUNTERS, if the kernel grants them
+        std::optional<std::size_t> peak_memory;  // of operators that hold rows, see operator/memory.h
+        std::size_t spilled_bytes = 0;  // written to disk by such operators when over the memory budget
+        std::vector<std::unique_ptr<PlanNode>> children;
+
+        PlanNode(std::string name, std::string detail): name{std::move(name)}, detail{std::move(detail)} {}
+
+        std::size_t input_rows() const {
+            if (rows_in) {
+                return rows_in.value();
+            }
+            std::size_t n = 0;
+            for (const auto& c: children) {
+                n += c->rows_out;
+            }
+            return n;
+        }
+
+        std::chrono::nanoseconds self_time() const {
+            auto t = time;
+            for (const auto& c: children) {
+                t -= c->time;
+            }
+            return t;
+        }
+
+        std::size_t self_bytes() const {
+            std::size_t b = bytes;
+            for (const auto& c: children) {
+                b -= std::min(b, c->bytes);
+            }
+            return b;
+        }
+
+        std::optional<HardwareCounters> self_counters() const {
+            if (not counters) {
+                return std::nullopt;
+            }
+            HardwareCounters hc = counters.value();
+            for (const auto& c: children) {
+                if (c->counters) {
+                    hc -= c->counters.value();
+                }
+            }
+            return hc;
+        }
+
+        void print(std::ostream& os, const std::string& indent = "", bool last = true, bool root = true) const {
+            const auto ms = [](std::chrono::nanoseconds ns) { return std::chrono::duration<double, std::milli>(ns).count(); };
+            os << indent << (root ? "" : last ? "└─ " : "├─ ") << name;
+            if (not detail.empty()) {
+                os << " [" << detail << "]";
+            }
+            os << std::fixed << std::setprecision(3)
+               << "  rows in=" << input_rows() << " out=" << rows_out
+               << "  time=" << ms(time) << "ms self=" << ms(self_time()) << "ms"
+               << "  bytes=" << bytes << " self=" << self_bytes();
+            os.unsetf(std::ios_base::floatfield);
+            if (peak_memory) {
+                os << "  memory peak=" << peak_memory.value();
+            }
+            if (spilled_bytes) {
+                os << " spilled=" << spilled_bytes;
+            }
+            if (auto hc = self_counters()) {
+                os << std::setprecision(2) << "  self: " << hc.value() << std::setprecision(6);
+            }
+            os << "\n";
+            const std::string child_indent = indent + (root ? "" : last ? "   " : "│  ");
+            for (std::size_t i = 0; i < children.size(); ++i) {
+                children[i]->print(os, child_indent, i + 1 == children.size(), false);
+            }
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, const PlanNode& node) {
+            node.print(os);
+            return os;
+        }
+    };
+
+namespace impl {
+#ifdef CTSQL_INSTRUMENT
+    static constexpr bool instrumented = true;
+#else
+    static constexpr bool instrumented = false;
+#endif
+#ifdef CTSQL_PERF_COUNTERS
+    static constexpr bool count_events = true;
+#else
+    static constexpr bool count_events = false;
+#endif
+
+    inline thread_local std::size_t allocated_bytes = 0;
+    inline thread_local PlanNode* current_node = nullptr;  // the operator running on this thread
+    inline thread_local std::shared_ptr<PlanNode> last_root;
+
+    // a child of the running operator, which belongs to the same query, or the root of a new plan
+    inline PlanNode& open_node(std::string name, std::string detail, uint64_t query_id = 0) {
+        if (current_node) {
+            PlanNode& child = *current_node->children.emplace_back(std::make_unique<PlanNode>(std::move(name), std::move(detail)));
+            child.query_id = query_id ? query_id : current_node->query_id;
+            return child;
+        }
+        last_root = std::make_shared<PlanNode>(std::move(name), std::move(detail));
+        last_root->query_id = query_id;
+        return *last_root;
+    }
+
+    // charges the time and allocations until it goes out of scope to node; must not span a suspension point
+    class Interval {
+    public:
+        // the counters are read first so that opening them on a thread's first interval is not timed
+        explicit Interval(PlanNode& node)
+            : node{node}, previous{current_node}, events{count_events ? PerfCounters::this_thread().read() : std::nullopt},
+              start{std::chrono::steady_clock::now()}, bytes{allocated_bytes} {
+            current_node = &node;
+        }
+        ~Interval() {
+            if constexpr (count_events) {
+                if (auto now = PerfCounters::this_thread().read(); now and events) {
+                    now.value() -= events.value();
+                    node.counters = node.counters.value_or(HardwareCounters{}) += now.value();
+                }
+            }
+            node.time += std::chrono::steady_clock::now() - start;
+            node.bytes += allocated_bytes - bytes;
+            current_node = previous;
+        }
+        Interval(const Interval&) = delete;
+        Interval& operator=(const Interval&) = delete;
+
+    private:
+        PlanNode& node;
+        PlanNode* previous;
+        std::optional<HardwareCounters> events;
+        std::chrono::steady_clock::time_point start;
+        std::size_t bytes;
+    };
+
+    // one trace event from the first to the last moment the operator of node runs, i.e. from creation until its output
+    // is exhausted or dropped. the detail of the root is the query text, which goes to the arguments rather than the name
+    template<bool enabled = tracing>
+    class OperatorSpan {
+    public:
+        OperatorSpan(const PlanNode& node, bool root): node{node}, root{root}, thread{trace_thread()}, start{std::chrono::steady_clock::now()} {}
+        ~OperatorSpan() {
+            const auto end = std::chrono::steady_clock::now();
+            std::string label = node.name;
+            if (not root and not node.detail.empty()) {
+                label += " [" + node.detail + "]";
+            }
+            char query_id[17];
+            std::snprintf(query_id, sizeof(query_id), "%016llx", static_cast<unsigned long long>(node.query_id));
+            std::string args = "\"query_id\": \"" + std::string(query_id) + "\"";
+            if (root) {
+                args += ", \"sql\": \"" + json_escape(node.detail) + "\"";
+            }
+            args += ", \"rows_in\": " + std::to_string(node.input_rows()) + ", \"rows_out\": " + std::to_string(node.rows_out)
+                    + ", \"busy_us\": " + std::to_string(std::chrono::duration<double, std::micro>(node.time).count());
+            TraceLog::instance().add({std::move(label), "operator", start, end - start, thread, std::move(args)});
+        }
+        OperatorSpan(const OperatorSpan&) = delete;
+        OperatorSpan& operator=(const OperatorSpan&) = delete;
+
+    private:
+        const PlanNode& node;
+        bool root;
+        std::size_t thread;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    template<>
+    class OperatorSpan<false> {
+    public:
+        constexpr OperatorSpan(const PlanNode&, bool) {}
+    };
+
+    // forwards the rows of input and records them, and the work done to produce them, in a node of its own
+    template<typename T>
+    std::generator<T> observe(std::string name, std::string detail, std::ranges::range auto input, std::optional<std::size_t> rows_in, uint64_t query_id) {
+        PlanNode& node = open_node(std::move(name), std::move(detail), query_id);
+        [[maybe_unused]] const std::shared_ptr<PlanNode> root = &node == last_root.get() ? last_root : nullptr;  // the plan outlives the query
+        [[maybe_unused]] OperatorSpan span(node, root != nullptr);
+        node.rows_in = rows_in;
+        auto it = [&]() {
+            Interval interval(node);
+            return std::ranges::begin(input);
+        }();
+        while (it != std::ranges::end(input)) {
+            ++node.rows_out;
+            co_yield *it;
+            Interval interval(node);
+            ++it;
+        }
+    }
+
+    // wraps an operator's output in observe when instrumented; otherwise hands it back untouched.
+    // the root operator of a query passes the query's id, the others inherit it
+    inline auto instrument(std::string_view name, std::string_view detail, std::ranges::range auto&& rows, std::optional<std::size_t> rows_in = std::nullopt,
+                           uint64_t query_id = 0) {
+        using Rows = std::remove_cvref_t<decltype(rows)>;
+        if constexpr (instrumented) {
+            return observe<std::ranges::range_value_t<Rows>>(std::string(name), std::string(detail), std::move(rows), rows_in, query_id);
+        } else {
+            return Rows(std::move(rows));
+        }
+    }
+
+    // the total number of rows of the inputs, if all of them know it
+    template<typename... Inputs>
+    std::optional<std::size_t> known_size(const Inputs&... inputs) {
+        if constexpr ((... and std::ranges::sized_range<const Inputs>)) {
+            return (... + static_cast<std::size_t>(std::ranges::size(inputs)));
+        } else {
+            return std::nullopt;
+        }
+    }
+
+    // for operators that pull their inputs themselves (joins): n more rows were read by the running operator
+    inline void count_input(std::size_t n = 1) {
+        if constexpr (instrumented) {
+            if (current_node) {
+                current_node->rows_in = current_node->rows_in.value_or(0) + n;
+            }
+        }
+    }
+
+    // a step of an operator that runs to completion without yielding, such as the build side of a hash join.
+    // it gets a node of its own; the rows it reads also count as input of the operator
+    template<bool enabled = instrumented>
+    class Phase {
+    public:
+        Phase(std::string_view name, std::string_view detail)
+            : parent{current_node}, node{open_node(std::string(name), std::string(detail))}, span{node, false}, interval{node} {}
+        ~Phase() {
+            node.rows_out = node.rows_in.value_or(0);
+            if (parent) {
+                parent->rows_in = parent->rows_in.value_or(0) + node.rows_out;
+            }
+        }
+
+    private:
+        PlanNode* parent;
+        PlanNode& node;
+        OperatorSpan<> span;  // emitted after interval has charged the phase
+        Interval interval;
+    };
+
+    template<>
+    class Phase<false> {
+    public:
+        constexpr Phase(std::string_view, std::string_view) {}
+    };
+}
+
+    // the statistics of the query on this thread whose results were most recently started; empty unless
+    // CTSQL_INSTRUMENT is defined. the counts are final once its results have been consumed
+    inline std::shared_ptr<const PlanNode> last_profile() {
+        return impl::last_root;
+    }
+}
+
+// replaces the global allocation functions with ones that count the requested bytes; use in exactly one .cpp file
+#define CTSQL_COUNT_ALLOCATIONS() \
+    void* operator new(std::size_t size) { \
+        ::ctsql::impl::allocated_bytes += size; \
+        if (void* p = std::malloc(size ? size : 1)) { \
+            return p; \
+        } \
+        throw std::bad_alloc(); \
+    } \
+    void* operator new[](std::size_t size) { return ::operator new(size); } \
+    void operator delete(void* p) noexcept { std::free(p); } \
+    void operator delete[](void* p) noexcept { std::free(p); } \
+    void operator delete(void* p, std::size_t) noexcept { std::free(p); } \
+    void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+#endif //SQL_INSTRUMENT_H
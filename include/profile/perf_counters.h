@@ -0,0 +1,165 @@
+#ifndef SQL_PERF_COUNTERS_H
+#define SQL_PERF_COUNTERS_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string_view>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// hardware event counts for profiles (profile/instrument.h), read with perf_event_open on linux. compiled in with
+// -DCTSQL_PERF_COUNTERS; a thread whose counters cannot be opened records none, and the rest of the profile is unaffected
+
+namespace ctsql {
+    // events counted in user space on the running thread
+    struct HardwareCounters {
+        enum Event {
+            CYCLES = 0, INSTRUCTIONS, LLC_MISSES, BRANCH_MISSES, NUM_EVENTS
+        };
+        static constexpr std::array<std::string_view, NUM_EVENTS> names{"cycles", "instructions", "llc-misses", "branch-misses"};
+
+        std::array<uint64_t, NUM_EVENTS> values{};
+        std::array<bool, NUM_EVENTS> counted{};  // not every CPU (or hypervisor) offers every event
+
+        HardwareCounters& operator+=(const HardwareCounters& other) {
+            for (std::size_t e = 0; e < NUM_EVENTS; ++e) {
+                values[e] += other.values[e];
+                counted[e] = counted[e] or other.counted[e];
+            }
+            return *this;
+        }
+
+        // saturating, since multiplexed counts are estimates
+        HardwareCounters& operator-=(const HardwareCounters& other) {
+            for (std::size_t e = 0; e < NUM_EVENTS; ++e) {
+                values[e] -= std::min(values[e], other.values[e]);
+            }
+            return *this;
+        }
+
+        std::optional<double> ipc() const {
+            if (not counted[CYCLES] or not counted[INSTRUCTIONS] or values[CYCLES] == 0) {
+                return std::nullopt;
+            }
+            return static_cast<double>(values[INSTRUCTIONS]) / static_cast<double>(values[CYCLES]);
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, const HardwareCounters& hc) {
+            const char* sep = "";
+            for (std::size_t e = 0; e < NUM_EVENTS; ++e) {
+                if (hc.counted[e]) {
+                    os << sep << names[e] << "=" << hc.values[e];
+                    sep = " ";
+                }
+                if (e == INSTRUCTIONS and hc.ipc()) {
+                    os << sep << "ipc=" << hc.ipc().value();
+                }
+            }
+            return os;
+        }
+    };
+
+namespace impl {
+    // one group of counters per thread, opened on first use and read with a single read(2).
+    // if the kernel refuses them (no PMU in a VM, perf_event_paranoid, seccomp in a container, ...) read() returns nullopt
+    class PerfCounters {
+    public:
+        static const PerfCounters& this_thread() {
+            thread_local const PerfCounters counters;
+            return counters;
+        }
+
+        bool available() const { return leader >= 0; }
+
+        std::optional<HardwareCounters> read() const {
+#if defined(__linux__)
+            if (not available()) {
+                return std::nullopt;
+            }
+            // PERF_FORMAT_GROUP layout: nr, time enabled, time running, then one value per event in the order opened
+            std::array<uint64_t, 3 + HardwareCounters::NUM_EVENTS> buf{};
+            const ssize_t n = ::read(leader, buf.data(), sizeof(buf));
+            // nr is only there if read() got that far, and the rest only if it got through all nr values
+            if (n < static_cast<ssize_t>(sizeof(uint64_t)) or buf[0] != num_open or n < static_cast<ssize_t>((3 + buf[0]) * sizeof(uint64_t))) {
+                return std::nullopt;
+            }
+            const uint64_t enabled = buf[1];
+            const uint64_t running = buf[2];
+            HardwareCounters hc;
+            for (std::size_t i = 0; i < num_open; ++i) {
+                uint64_t v = buf[3 + i];
+                if (running != 0 and running < enabled) {  // the PMU was shared with other groups; extrapolate
+                    v = static_cast<uint64_t>(static_cast<double>(v) * static_cast<double>(enabled) / static_cast<double>(running));
+                }
+                hc.values[events[i]] = v;
+                hc.counted[events[i]] = true;
+            }
+            return hc;
+#else
+            return std::nullopt;
+#endif
+        }
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        ~PerfCounters() {
+#if defined(__linux__)
+            for (std::size_t i = 0; i < num_open; ++i) {
+                ::close(fds[i]);
+            }
+#endif
+        }
+
+    private:
+        int leader = -1;
+        std::size_t num_open = 0;
+        std::array<int, HardwareCounters::NUM_EVENTS> fds{};
+        std::array<HardwareCounters::Event, HardwareCounters::NUM_EVENTS> events{};
+
+        PerfCounters() {
+#if defined(__linux__)
+            static constexpr std::array<uint64_t, HardwareCounters::NUM_EVENTS> configs{
+                    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+            for (std::size_t e = 0; e < configs.size(); ++e) {
+                perf_event_attr attr{};
+                attr.size = sizeof(attr);
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = configs[e];
+                attr.disabled = leader < 0;  // the group starts once complete
+                attr.exclude_kernel = 1;  // allowed up to perf_event_paranoid 2
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                // this thread, any cpu; an event the CPU lacks is skipped rather than failing the group
+                const int fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+                if (fd < 0) {
+                    continue;
+                }
+                if (leader < 0) {
+                    leader = fd;
+                }
+                fds[num_open] = fd;
+                events[num_open] = static_cast<HardwareCounters::Event>(e);
+                ++num_open;
+            }
+            if (leader >= 0 and ::ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0) {
+                for (std::size_t i = 0; i < num_open; ++i) {
+                    ::close(fds[i]);
+                }
+                leader = -1;
+                num_open = 0;
+            }
+#endif
+        }
+    };
+}
+}
+
+#endif //SQL_PERF_COUNTERS_H
@@ -0,0 +1,166 @@
+#ifndef SQL_TRACE_H
+#define SQL_TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// a timeline of query execution in the Chrome trace-event format, for chrome://tracing or ui.perfetto.dev.
+// compiled in with -DCTSQL_TRACE (which implies CTSQL_INSTRUMENT): every operator run becomes a span on the thread that
+// ran it, with its rows and busy time; so do hash join builds and the workers of a parallel sort.
+//
+//   for (auto&& row: process<QP>(input)) { ... }
+//   ctsql::write_trace("query.json");
+
+namespace ctsql {
+namespace impl {
+#ifdef CTSQL_TRACE
+    static constexpr bool tracing = true;
+#else
+    static constexpr bool tracing = false;
+#endif
+
+    // FNV-1a; identifies a query by its text across runs and builds
+    constexpr uint64_t fingerprint(std::string_view s) {
+        uint64_t h = 14695981039346656037ull;
+        for (char c: s) {
+            h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+        return h;
+    }
+
+    inline std::string json_escape(std::string_view s) {
+        static constexpr char hex[] = "0123456789abcdef";
+        std::string out;
+        for (char c: s) {
+            if (c == '"' or c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                out += "\\u00";
+                out += hex[(c >> 4) & 0xf];
+                out += hex[c & 0xf];
+            } else {
+                out += c;
+            }
+        }
+        return out;
+    }
+
+    // a complete ("X") event; args is the inside of a JSON object
+    struct TraceEvent {
+        std::string name;
+        std::string category;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::duration duration;
+        std::size_t thread;
+        std::string args;
+    };
+
+    // small thread numbers, in the order in which threads first start a span
+    inline std::size_t trace_thread() {
+        static std::atomic<std::size_t> next{0};
+        thread_local const std::size_t id = next++;
+        return id;
+    }
+
+    class TraceLog {
+    public:
+        static TraceLog& instance() {
+            static TraceLog log;
+            return log;
+        }
+
+        void add(TraceEvent event) {
+            std::lock_guard lock(mutex);
+            events.push_back(std::move(event));
+        }
+
+        void clear() {
+            std::lock_guard lock(mutex);
+            events.clear();
+        }
+
+        void write(std::ostream& os) {
+            std::lock_guard lock(mutex);
+            const auto us = [](auto d) { return std::chrono::duration<double, std::micro>(d).count(); };
+            auto epoch = std::chrono::steady_clock::time_point::max();
+            for (const auto& e: events) {
+                epoch = std::min(epoch, e.start);
+            }
+            std::size_t threads = 0;
+            os << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+            const char* sep = "\n";
+            for (const auto& e: events) {
+                os << sep << "{\"name\": \"" << json_escape(e.name) << "\", \"cat\": \"" << e.category << "\", \"ph\": \"X\", \"pid\": 1"
+                   << ", \"tid\": " << e.thread << ", \"ts\": " << us(e.start - epoch) << ", \"dur\": " << us(e.duration)
+                   << ", \"args\": {" << e.args << "}}";
+                threads = std::max(threads, e.thread + 1);
+                sep = ",\n";
+            }
+            for (std::size_t t = 0; t < threads; ++t) {
+                os << sep << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << t
+                   << ", \"args\": {\"name\": \"thread " << t << "\"}}";
+            }
+            os << "\n]}\n";
+        }
+
+    private:
+        TraceLog() = default;
+        std::mutex mutex;
+        std::vector<TraceEvent> events;
+    };
+
+    // a span covering its own lifetime on the current thread, e.g. a task of a parallel operator
+    template<bool enabled = tracing>
+    class TraceScope {
+    public:
+        TraceScope(std::string_view name, std::string_view category)
+            : name{name}, category{category}, thread{trace_thread()}, start{std::chrono::steady_clock::now()} {}
+        ~TraceScope() {
+            TraceLog::instance().add({std::string(name), std::string(category), start, std::chrono::steady_clock::now() - start, thread, ""});
+        }
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+
+    private:
+        std::string_view name;
+        std::string_view category;
+        std::size_t thread;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    template<>
+    class TraceScope<false> {
+    public:
+        constexpr TraceScope(std::string_view, std::string_view) {}
+    };
+}
+
+    // the trace-event JSON of everything traced so far in this process; empty unless CTSQL_TRACE is defined
+    inline void write_trace(std::ostream& os) {
+        impl::TraceLog::instance().write(os);
+    }
+
+    inline void write_trace(const std::string& path) {
+        std::ofstream file(path);
+        if (not file) {
+            throw std::runtime_error("cannot open trace file " + path);
+        }
+        write_trace(file);
+    }
+
+    inline void clear_trace() {
+        impl::TraceLog::instance().clear();
+    }
+}
+
+#endif //SQL_TRACE_H
@@ -0,0 +1,68 @@
+#ifndef SQL_REGISTRY_H
+#define SQL_REGISTRY_H
+
+#include <__generator.hpp>
+#include <type_traits>
+#include <vector>
+#include "common.h"
+
+// queries declared in a header and defined in exactly one translation unit. the declaring side needs neither the
+// parser nor the planner, so files that only run registered queries skip building the LR tables (the bulk of the
+// compile time and compiler memory of any file including planner.h), and each query is planned and compiled once
+// per build however many files run it. queries with placeholders cannot be registered.
+//
+//   // queries.h
+//   CTSQL_DECLARE_QUERY(names_by_x, (std::tuple<std::string, int>), Point);
+//   // queries.cpp, after including planner.h and queries.h
+//   CTSQL_DEFINE_QUERY(names_by_x, "SELECT name, x FROM Point WHERE x > 1", Point);
+//   // anywhere; the inputs must outlive the generator, as with process
+//   for (const auto& row: names_by_x::run(points)) { ... }
+//
+// the result type is in parentheses so that it may contain commas; the definition checks it against the planner's.
+
+namespace ctsql {
+namespace impl {
+    template<typename T>
+    struct Unparen;
+
+    template<typename T>
+    struct Unparen<void(T)> {
+        using type = T;
+    };
+
+    template<typename QP, typename Declared>
+    constexpr void check_registered() {
+        static_assert(QP::num_params == 0, "registered queries cannot have placeholders");
+        static_assert(std::is_same_v<typename QP::ResultType, Declared>, "the declared result type differs from the one of the query");
+    }
+}
+}
+
+#define CTSQL_DETAIL_CAT(a, b) CTSQL_DETAIL_CAT_(a, b)
+#define CTSQL_DETAIL_CAT_(a, b) a##b
+#define CTSQL_DETAIL_NARG(...) CTSQL_DETAIL_NARG_(__VA_ARGS__, 2, 1, 0)
+#define CTSQL_DETAIL_NARG_(_1, _2, N, ...) N
+
+#define CTSQL_DETAIL_INPUTS_1(S1) const std::vector<::ctsql::SchemaTuple<S1>>& l_input
+#define CTSQL_DETAIL_INPUTS_2(S1, S2) const std::vector<::ctsql::SchemaTuple<S1>>& l_input, const std::vector<::ctsql::SchemaTuple<S2>>& r_input
+#define CTSQL_DETAIL_ARGS_1 l_input
+#define CTSQL_DETAIL_ARGS_2 l_input, r_input
+
+#define CTSQL_DETAIL_INPUTS(...) CTSQL_DETAIL_CAT(CTSQL_DETAIL_INPUTS_, CTSQL_DETAIL_NARG(__VA_ARGS__))(__VA_ARGS__)
+#define CTSQL_DETAIL_ARGS(...) CTSQL_DETAIL_CAT(CTSQL_DETAIL_ARGS_, CTSQL_DETAIL_NARG(__VA_ARGS__))
+
+#define CTSQL_DECLARE_QUERY(name, result_type, ...) \
+    struct name { \
+        using ResultType = typename ::ctsql::impl::Unparen<void result_type>::type; \
+        static std::generator<ResultType> run(CTSQL_DETAIL_INPUTS(__VA_ARGS__)); \
+    }
+
+#define CTSQL_DEFINE_QUERY(name, sql, ...) \
+    std::generator<name::ResultType> name::run(CTSQL_DETAIL_INPUTS(__VA_ARGS__)) { \
+        static constexpr char query_str[] = sql; \
+        using QP = ::ctsql::QueryPlanner<::refl::make_const_string(query_str), __VA_ARGS__>; \
+        ::ctsql::impl::check_registered<QP, name::ResultType>(); \
+        return ::ctsql::process<QP>(CTSQL_DETAIL_ARGS(__VA_ARGS__)); \
+    }
+
+#endif //SQL_REGISTRY_H
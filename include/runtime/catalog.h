@@ -0,0 +1,384 @@
+#ifndef SQL_RUNTIME_CATALOG_H
+#define SQL_RUNTIME_CATALOG_H
+
+#include <cctype>
+#include <list>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include "common.h"
+#include "parser/parser.h"
+#include "parser/preproc.h"
+#include "operator/sort.h"
+#include "runtime/kernels.h"
+
+namespace ctsql {
+namespace impl {
+    // collapses runs of whitespace outside of string literals, so that reformatted queries share a cached plan
+    inline std::string normalize_query(std::string_view sql) {
+        std::string text;
+        char quote = 0;
+        bool pending_space = false;
+        for (char c: sql) {
+            if (quote == 0 and std::isspace(static_cast<unsigned char>(c))) {
+                pending_space = not text.empty();
+                continue;
+            }
+            if (pending_space) {
+                text.push_back(' ');
+                pending_space = false;
+            }
+            if (quote == 0 and (c == '\'' or c == '"')) {
+                quote = c;
+            } else if (c == quote) {
+                quote = 0;
+            }
+            text.push_back(c);
+        }
+        return text;
+    }
+
+    // a query bound to one registered table, ready to run any number of times
+    class RuntimePlan {
+    public:
+        virtual ~RuntimePlan() = default;
+        // each row is valid until the next one is read
+        virtual std::generator<const Row&> run() const = 0;
+        const std::vector<std::string>& columns() const { return column_names; }
+
+    protected:
+        std::vector<std::string> column_names;
+    };
+
+    // single-table plan over rows of schema S: the WHERE clause, projection, aggregation and ordering are
+    // resolved once into kernels over SchemaTuple<S>
+    template<Reflectable S>
+    class TypedPlan: public RuntimePlan {
+    public:
+        using STuple = SchemaTuple<S>;
+        using K = Kernels<STuple>;
+
+        TypedPlan(const std::vector<STuple>& rows, const Query& parsed): rows{rows} {
+            const Query query = resolve_table_name<S, void>(parsed);
+            for (const auto& bat: query.where_condition) {
+                std::vector<Predicate>& term = where.emplace_back();
+                for (const auto& bf: bat) {
+                    const Value rhs = std::visit([](auto v) -> Value {
+                        if constexpr (std::is_same_v<decltype(v), Param>) {
+                            throw std::runtime_error("placeholders are not supported by runtime queries");
+                        } else if constexpr (std::is_same_v<decltype(v), std::string_view>) {
+                            return std::string(v);
+                        } else {
+                            return v;
+                        }
+                    }, bf.rhs);
+                    const auto kernel = K::compare_kernel(column_index(bf.lhs), bf.cop, rhs);
+                    if (not kernel) {
+                        throw std::runtime_error("cannot compare column " + std::string(bf.lhs.column_name) + " with a literal of another type");
+                    }
+                    term.push_back({kernel, rhs});
+                }
+            }
+
+            if (query.cns.empty()) {  // SELECT *
+                for (std::size_t i=0; i<K::num_columns; ++i) {
+                    outputs.push_back({K::project[i], {}});
+                    column_names.emplace_back(member_list<S>[i]);
+                }
+            }
+            for (const auto& cn: query.cns) {
+                const std::size_t idx = cn.agg == AggOp::COUNT ? 0 : column_index(cn);
+                const AggKernel<STuple> agg = K::aggregate[idx][static_cast<std::size_t>(cn.agg)];
+                if (not agg.update) {
+                    throw std::runtime_error("MAX/MIN/SUM over string/non-arithmetic values are not supported");
+                }
+                outputs.push_back({K::project[idx], agg});
+                need_reduce = need_reduce or cn.agg != AggOp::NONE;
+                std::ostringstream name;
+                name << ColumnName{"", cn.column_name, "", cn.agg};
+                column_names.push_back(cn.alias.empty() ? name.str() : std::string(cn.alias));
+            }
+            if (need_reduce) {
+                for (const auto& key: query.group_by_keys) {
+                    group_by.push_back(K::project[column_index(key)]);
+                }
+            }
+
+            for (const auto& ok: query.order_by) {
+                const std::size_t idx = order_index<S, void>(query, ok);
+                if (idx >= outputs.size()) {
+                    throw std::runtime_error("cannot resolve column name");
+                }
+                order_by.emplace_back(idx, ok.descending);
+            }
+            limit = query.limit;
+        }
+
+        std::generator<const Row&> run() const override {
+            if (not need_reduce and order_by.empty()) {  // nothing blocks; stream straight from the scan
+                std::size_t emitted = 0;
+                Row out(outputs.size());  // reused for every row
+                for (const STuple& row: rows) {
+                    if (limit and emitted == *limit) {
+                        co_return;
+                    }
+                    if (admits(row)) {
+                        project(row, out);
+                        co_yield out;
+                        ++emitted;
+                    }
+                }
+                co_return;
+            }
+            std::vector<Row> results = need_reduce ? reduce() : select_all();
+            order_limit(results);
+            for (const Row& r: results) {
+                co_yield r;
+            }
+        }
+
+    private:
+        struct Predicate {
+            CompareKernel<STuple> kernel;
+            Value rhs;
+        };
+        struct Output {
+            ProjectKernel<STuple> project;
+            AggKernel<STuple> agg;
+        };
+
+        static std::size_t column_index(const ColumnReference auto& cr) {
+            const std::size_t idx = get_index<S, void>(cr);
+            if (idx >= K::num_columns) {
+                throw std::runtime_error("cannot resolve column name " + std::string(cr.column_name));
+            }
+            return idx;
+        }
+
+        // one of the AND terms must hold
+        bool admits(const STuple& row) const {
+            if (where.empty()) {
+                return true;
+            }
+            for (const auto& term: where) {
+                bool holds = true;
+                for (const Predicate& p: term) {
+                    if (not p.kernel(row, p.rhs)) {
+                        holds = false;
+                        break;
+                    }
+                }
+                if (holds) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void project(const STuple& row, Row& out) const {
+            for (std::size_t i=0; i<outputs.size(); ++i) {
+                out[i] = outputs[i].project(row);
+            }
+        }
+
+        std::vector<Row> select_all() const {
+            std::vector<Row> results;
+            for (const STuple& row: rows) {
+                if (admits(row)) {
+                    project(row, results.emplace_back(outputs.size()));
+                }
+            }
+            return results;
+        }
+
+        Row init(const STuple* first) const {
+            Row acc;
+            acc.reserve(outputs.size());
+            for (const Output& o: outputs) {
+                acc.push_back(o.agg.init(first));
+            }
+            return acc;
+        }
+
+        void update(Row& acc, const STuple& row) const {
+            for (std::size_t i=0; i<outputs.size(); ++i) {
+                outputs[i].agg.update(acc[i], row);
+            }
+        }
+
+        std::vector<Row> reduce() const {
+            if (group_by.empty()) {  // a global aggregate has exactly one row, even over no input
+                std::optional<Row> acc;
+                for (const STuple& row: rows) {
+                    if (admits(row)) {
+                        if (not acc) {
+                            acc = init(&row);
+                        }
+                        update(*acc, row);
+                    }
+                }
+                return {acc ? std::move(*acc) : init(nullptr)};
+            }
+            std::unordered_map<Row, Row, RowHash> groups;
+            Row key(group_by.size());  // the probe, reused for every row; copied only for a new group
+            for (const STuple& row: rows) {
+                if (not admits(row)) {
+                    continue;
+                }
+                for (std::size_t i=0; i<group_by.size(); ++i) {
+                    key[i] = group_by[i](row);
+                }
+                auto pos = groups.find(key);
+                if (pos == groups.end()) {
+                    pos = groups.emplace(key, init(&row)).first;
+                }
+                update(pos->second, row);
+            }
+            std::vector<Row> results;
+            results.reserve(groups.size());
+            for (auto& kv: groups) {
+                results.push_back(std::move(kv.second));
+            }
+            return results;
+        }
+
+        void order_limit(std::vector<Row>& results) const {
+            const auto before = [this](const Row& lhs, const Row& rhs) {
+                for (const auto& [idx, descending]: order_by) {
+                    if (lhs[idx] != rhs[idx]) {
+                        return (lhs[idx] < rhs[idx]) != descending;
+                    }
+                }
+                return false;
+            };
+            if (not order_by.empty() and limit and *limit < results.size()) {
+                std::partial_sort(results.begin(), results.begin() + *limit, results.end(), before);
+            } else if (not order_by.empty()) {
+                std::stable_sort(results.begin(), results.end(), before);
+            }
+            if (limit and *limit < results.size()) {
+                results.resize(*limit);
+            }
+        }
+
+        const std::vector<STuple>& rows;
+        std::vector<std::vector<Predicate>> where;  // DNF
+        std::vector<Output> outputs;
+        std::vector<ProjectKernel<STuple>> group_by;
+        std::vector<std::pair<std::size_t, bool>> order_by;  // position in the output row, descending
+        std::optional<std::size_t> limit;
+        bool need_reduce = false;
+    };
+
+    class RuntimeTable {
+    public:
+        virtual ~RuntimeTable() = default;
+        virtual std::shared_ptr<const RuntimePlan> plan(const Query& query) const = 0;
+    };
+
+    template<Reflectable S>
+    class TypedTable: public RuntimeTable {
+    public:
+        explicit TypedTable(const std::vector<SchemaTuple<S>>& rows): rows{rows} {}
+        std::shared_ptr<const RuntimePlan> plan(const Query& query) const override {
+            return std::make_shared<TypedPlan<S>>(rows, query);
+        }
+
+    private:
+        const std::vector<SchemaTuple<S>>& rows;
+    };
+
+    inline std::generator<const Row&> run_plan(std::shared_ptr<const RuntimePlan> plan) {
+        co_yield std::ranges::elements_of(plan->run());
+    }
+}
+
+    // entry point for SQL that is only known at run time. it is parsed by the same grammar as compile-time
+    // queries and planned against the registered tables; plans are cached by their normalized text, up to
+    // max_cached_plans of them, dropping the least recently used first (0 keeps every plan).
+    // only single-table queries without placeholders are supported. registered rows are referenced, not copied: a
+    // vector must outlive every plan prepared over it and every generator of its rows, including those of a plan
+    // that registering another vector under the same name has dropped from the cache
+    class Catalog {
+    public:
+        explicit Catalog(std::size_t max_cached_plans = 1024): max_cached_plans{max_cached_plans} {}
+
+        template<Reflectable S>
+        void register_table(const std::vector<SchemaTuple<S>>& rows, std::string name = std::string(refl::reflect<S>().name.str_view())) {
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                static_assert((... and impl::RuntimeColumn<std::tuple_element_t<I, SchemaTuple<S>>>), "runtime queries only read numeric and string columns");
+            }(std::make_index_sequence<std::tuple_size_v<SchemaTuple<S>>>());
+            for (auto it = lru.begin(); it != lru.end();) {  // they read the old rows
+                if (it->table == name) {
+                    plans.erase(it->text);
+                    it = lru.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            tables[std::move(name)] = std::make_unique<impl::TypedTable<S>>(rows);
+        }
+
+        std::shared_ptr<const impl::RuntimePlan> prepare(std::string_view sql) {
+            std::string text = impl::normalize_query(sql);
+            if (auto pos = plans.find(text); pos != plans.end()) {
+                lru.splice(lru.begin(), lru, pos->second);
+                return pos->second->plan;
+            }
+            // the parsed query refers into the buffer, which only has to outlive planning
+            const ctpg::buffers::string_buffer buffer{std::string(text)};
+            std::ostringstream errors;
+            const auto parsed = SelectParser::p.parse(buffer, errors);
+            if (not parsed) {
+                std::string message = errors.str();
+                while (not message.empty() and std::isspace(static_cast<unsigned char>(message.back()))) {
+                    message.pop_back();
+                }
+                throw std::runtime_error("cannot parse query: " + message);
+            }
+            const Query query = impl::dealias_query(parsed.value());
+            if (query.tns.second) {
+                throw std::runtime_error("runtime queries only read a single table");
+            }
+            auto table = tables.find(std::string(query.tns.first.name));
+            if (table == tables.end()) {
+                throw std::runtime_error("unknown table " + std::string(query.tns.first.name));
+            }
+            auto plan = table->second->plan(query);
+            lru.push_front(CachedPlan{text, table->first, plan});
+            plans.emplace(std::move(text), lru.begin());
+            if (max_cached_plans != 0 and lru.size() > max_cached_plans) {
+                plans.erase(lru.back().text);
+                lru.pop_back();
+            }
+            return plan;
+        }
+
+        // each row is valid until the next one is read
+        std::generator<const Row&> query(std::string_view sql) {
+            return impl::run_plan(prepare(sql));
+        }
+
+        std::size_t num_cached_plans() const { return plans.size(); }
+
+        // plans already handed out stay valid
+        void clear_cached_plans() {
+            plans.clear();
+            lru.clear();
+        }
+
+    private:
+        struct CachedPlan {
+            std::string text;
+            std::string table;
+            std::shared_ptr<const impl::RuntimePlan> plan;
+        };
+
+        std::size_t max_cached_plans;
+        std::unordered_map<std::string, std::unique_ptr<impl::RuntimeTable>> tables;
+        std::list<CachedPlan> lru;  // most recently used first
+        std::unordered_map<std::string, std::list<CachedPlan>::iterator> plans;
+    };
+}
+
+#endif //SQL_RUNTIME_CATALOG_H
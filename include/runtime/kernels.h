@@ -0,0 +1,169 @@
+#ifndef SQL_RUNTIME_KERNELS_H
+#define SQL_RUNTIME_KERNELS_H
+
+#include <limits>
+#include <string>
+#include <variant>
+#include <vector>
+#include "common.h"
+
+namespace ctsql {
+    // a value of a query planned at run time: integral columns widen to int64_t, floating-point ones to double
+    using Value = std::variant<int64_t, double, std::string>;
+    using Row = std::vector<Value>;
+
+namespace impl {
+    template<typename T>
+    concept RuntimeColumn = std::is_arithmetic_v<T> or std::is_convertible_v<const T&, std::string_view>;
+
+    template<typename T>
+    Value to_value(const T& v) {
+        if constexpr (std::is_integral_v<T>) {
+            return static_cast<int64_t>(v);
+        } else if constexpr (std::is_floating_point_v<T>) {
+            return static_cast<double>(v);
+        } else {
+            return std::string(std::string_view(v));
+        }
+    }
+
+    // the accumulator of SUM/MIN/MAX over a numeric column
+    template<typename T>
+    using Accumulator = std::conditional_t<std::is_integral_v<T>, int64_t, double>;
+
+    struct RowHash {
+        std::size_t operator()(const Row& row) const {
+            std::size_t seed = row.size();
+            for (const Value& v: row) {
+                seed ^= std::hash<Value>()(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            }
+            return seed;
+        }
+    };
+
+    // kernels are instantiated per (column, operator, literal type) of each registered schema. a runtime plan only
+    // picks function pointers out of these tables, so the per-row work runs code specialized to the column types
+    template<typename STuple>
+    using CompareKernel = bool (*)(const STuple&, const Value&);
+    template<typename STuple>
+    using ProjectKernel = Value (*)(const STuple&);
+
+    template<typename STuple>
+    struct AggKernel {
+        Value (*init)(const STuple*);  // state of a group from its first row; nullptr for an empty global aggregate
+        void (*update)(Value&, const STuple&);
+    };
+
+    static constexpr std::size_t num_comp_ops = static_cast<std::size_t>(CompOp::NEQ) + 1;
+    static constexpr std::size_t num_agg_ops = static_cast<std::size_t>(AggOp::MIN) + 1;
+
+    template<typename STuple, std::size_t I, CompOp cop, typename R>
+    bool compare_kernel(const STuple& row, const Value& rhs) {
+        constexpr auto comp_f = ctsql::to_operator<cop>();
+        if constexpr (std::is_arithmetic_v<R>) {
+            return comp_f(std::get<I>(row), *std::get_if<R>(&rhs));
+        } else {
+            return comp_f(std::string_view(std::get<I>(row)), std::string_view(*std::get_if<R>(&rhs)));
+        }
+    }
+
+    template<typename STuple, std::size_t I, std::size_t C>
+    constexpr CompareKernel<STuple> pick_compare_kernel() {
+        using T = std::tuple_element_t<I, STuple>;
+        using R = std::variant_alternative_t<C % std::variant_size_v<Value>, Value>;
+        if constexpr (std::is_arithmetic_v<T> == std::is_arithmetic_v<R>) {
+            return &compare_kernel<STuple, I, static_cast<CompOp>(C / std::variant_size_v<Value>), R>;
+        } else {  // a string column against a number, or the other way around
+            return nullptr;
+        }
+    }
+
+    template<typename STuple, std::size_t I>
+    Value project_kernel(const STuple& row) {
+        return to_value(std::get<I>(row));
+    }
+
+    template<typename STuple, std::size_t I, AggOp agg>
+    Value init_kernel(const STuple* first) {
+        using T = std::tuple_element_t<I, STuple>;
+        if constexpr (agg == AggOp::COUNT) {
+            return int64_t{0};
+        } else if constexpr (agg == AggOp::SUM) {
+            return Accumulator<T>{0};
+        } else if (first) {  // MIN/MAX/plain columns start at the first value
+            return to_value(std::get<I>(*first));
+        } else if constexpr (agg == AggOp::MAX) {
+            return static_cast<Accumulator<T>>(std::numeric_limits<T>::lowest());
+        } else if constexpr (agg == AggOp::MIN) {
+            return static_cast<Accumulator<T>>(std::numeric_limits<T>::max());
+        } else {
+            return to_value(T{});
+        }
+    }
+
+    template<typename STuple, std::size_t I, AggOp agg>
+    void update_kernel(Value& acc, const STuple& row) {
+        if constexpr (agg == AggOp::COUNT) {
+            ++*std::get_if<int64_t>(&acc);
+        } else if constexpr (agg != AggOp::NONE) {  // a plain column keeps its first value
+            using A = Accumulator<std::tuple_element_t<I, STuple>>;
+            A& a = *std::get_if<A>(&acc);
+            const A v = std::get<I>(row);
+            if constexpr (agg == AggOp::SUM) {
+                a += v;
+            } else if constexpr (agg == AggOp::MAX) {
+                a = v > a ? v : a;
+            } else {
+                a = v < a ? v : a;
+            }
+        }
+    }
+
+    template<typename STuple, std::size_t I, AggOp agg>
+    constexpr AggKernel<STuple> pick_agg_kernel() {
+        using T = std::tuple_element_t<I, STuple>;
+        if constexpr (agg == AggOp::NONE or agg == AggOp::COUNT or std::is_arithmetic_v<T>) {
+            return {&init_kernel<STuple, I, agg>, &update_kernel<STuple, I, agg>};
+        } else {  // SUM/MIN/MAX over strings
+            return {nullptr, nullptr};
+        }
+    }
+
+    template<typename STuple, std::size_t I, std::size_t... C>
+    constexpr auto make_compare_row(std::index_sequence<C...>) {
+        return std::array<CompareKernel<STuple>, sizeof...(C)>{pick_compare_kernel<STuple, I, C>()...};
+    }
+
+    template<typename STuple, std::size_t I, std::size_t... A>
+    constexpr auto make_agg_row(std::index_sequence<A...>) {
+        return std::array<AggKernel<STuple>, sizeof...(A)>{pick_agg_kernel<STuple, I, static_cast<AggOp>(A)>()...};
+    }
+
+    // all of the kernels of one schema, indexed by column first
+    template<typename STuple>
+    struct Kernels {
+        static constexpr std::size_t num_columns = std::tuple_size_v<STuple>;
+        static constexpr auto columns = std::make_index_sequence<num_columns>();
+
+        // [column][cop * variant_size + literal alternative]; nullptr where the types do not compare
+        static constexpr auto compare = []<std::size_t... I>(std::index_sequence<I...>) {
+            return std::array{make_compare_row<STuple, I>(std::make_index_sequence<num_comp_ops * std::variant_size_v<Value>>())...};
+        }(columns);
+
+        static constexpr auto project = []<std::size_t... I>(std::index_sequence<I...>) {
+            return std::array<ProjectKernel<STuple>, num_columns>{&project_kernel<STuple, I>...};
+        }(columns);
+
+        // [column][agg]; COUNT ignores the column
+        static constexpr auto aggregate = []<std::size_t... I>(std::index_sequence<I...>) {
+            return std::array{make_agg_row<STuple, I>(std::make_index_sequence<num_agg_ops>())...};
+        }(columns);
+
+        static CompareKernel<STuple> compare_kernel(std::size_t column, CompOp cop, const Value& rhs) {
+            return compare[column][static_cast<std::size_t>(cop) * std::variant_size_v<Value> + rhs.index()];
+        }
+    };
+}
+}
+
+#endif //SQL_RUNTIME_KERNELS_H
@@ -0,0 +1,88 @@
+#ifndef SQL_INCREMENTAL_JOIN_H
+#define SQL_INCREMENTAL_JOIN_H
+
+#include <vector>
+#include "planner.h"
+
+namespace ctsql {
+    // a two-table equi-join kept alive across appends to either side.
+    // both sides stay in hash tables keyed on the equi-join columns, so appending ΔL emits ΔL ⋈ R and
+    // appending ΔR emits L ⋈ ΔR (L already including earlier ΔL) -- O(delta) work instead of a full rejoin.
+    // the new joined tuples go through the query's reduce_project stage; with aggregates this yields the aggregate of the delta
+    template<typename QP>
+    class IncrementalJoin {
+    public:
+        using S1 = typename QP::S1Type;
+        using S2 = typename QP::S2Type;
+        static_assert(not std::is_void_v<S2>, "incremental joins are over two tables");
+        static_assert(QP::QPI::admits_eq_join, "incremental joins need an equi-join condition");
+        using Join = typename QP::QPI::Join;
+        using ResultType = typename QP::ResultType;
+
+        IncrementalJoin() = default;
+
+        // the tables are updated right away; the returned generator owns the new joined tuples,
+        // so it is not affected by later inserts and may be dropped without consuming it
+        std::generator<ResultType> insert_left(std::ranges::range auto& rows) {
+            std::vector<SchemaTuple2<S1, S2>> delta;
+            for (const auto& l_tuple: rows) {
+                if constexpr (QP::QPI::t0_selector) {
+                    if (not QP::QPI::t0_selector.value()(l_tuple)) {
+                        continue;
+                    }
+                }
+                auto key = Join::t0_hj_projector(l_tuple);
+                if (auto pos = right.find(key); pos != right.end()) {
+                    for (const auto& r_tuple: pos->second) {
+                        auto lr_tuple = std::tuple_cat(l_tuple, r_tuple);
+                        if (Join::predicate(lr_tuple)) {
+                            delta.emplace_back(std::move(lr_tuple));
+                        }
+                    }
+                }
+                left[std::move(key)].emplace_back(l_tuple);
+                ++left_size;
+            }
+            return emit(std::move(delta));
+        }
+
+        std::generator<ResultType> insert_right(std::ranges::range auto& rows) {
+            std::vector<SchemaTuple2<S1, S2>> delta;
+            for (const auto& r_tuple: rows) {
+                if constexpr (QP::QPI::t1_selector) {
+                    if (not QP::QPI::t1_selector.value()(r_tuple)) {
+                        continue;
+                    }
+                }
+                auto key = Join::t1_hj_projector(r_tuple);
+                if (auto pos = left.find(key); pos != left.end()) {
+                    for (const auto& l_tuple: pos->second) {
+                        auto lr_tuple = std::tuple_cat(l_tuple, r_tuple);
+                        if (Join::predicate(lr_tuple)) {
+                            delta.emplace_back(std::move(lr_tuple));
+                        }
+                    }
+                }
+                right[std::move(key)].emplace_back(r_tuple);
+                ++right_size;
+            }
+            return emit(std::move(delta));
+        }
+
+        // number of rows kept on each side (rows rejected by the single-table WHERE clauses are not kept)
+        std::size_t num_left() const { return left_size; }
+        std::size_t num_right() const { return right_size; }
+
+    private:
+        typename Join::S1Dict left;
+        typename Join::S2Dict right;
+        std::size_t left_size = 0;
+        std::size_t right_size = 0;
+
+        static std::generator<ResultType> emit(std::vector<SchemaTuple2<S1, S2>> joined) {
+            co_yield std::ranges::elements_of(QP::reduce_project(joined));
+        }
+    };
+}
+
+#endif //SQL_INCREMENTAL_JOIN_H
@@ -0,0 +1,150 @@
+#ifndef SQL_MATERIALIZED_VIEW_H
+#define SQL_MATERIALIZED_VIEW_H
+
+#include <set>
+#include <unordered_map>
+#include "planner.h"
+
+namespace ctsql {
+    // the result of an aggregate query over one table, kept up to date under row insertions and deletions.
+    // every delta touches only the groups of its own rows: COUNT/SUM are adjusted in place,
+    // MIN/MAX keep the multiset of their group's values so that a deleted extreme can be retracted
+    template<typename QP>
+    class MaterializedView {
+    public:
+        static_assert(std::is_void_v<typename QP::S2Type>, "materialized views are over a single table");
+        static_assert(QP::need_reduce, "materialized views maintain aggregate queries");
+
+        using STuple = typename QP::STuple;
+        using PTuple = typename QP::PTuple;
+        using ResultType = typename QP::ResultType;
+
+        static constexpr bool has_groups = not QP::res.group_by_keys.empty();
+        // without GROUP BY, every row maps to the empty key
+        static constexpr std::array group_by_indices = impl::make_group_by_indices<typename QP::S1Type, void, QP::res.group_by_keys.size()>(QP::res);
+        static constexpr auto gb_projector = impl::make_projector<group_by_indices>();
+        using GBTuple = impl::ProjectedTuple<STuple, group_by_indices>;
+
+        MaterializedView() = default;
+        explicit MaterializedView(std::ranges::range auto& rows) { insert(rows); }
+
+        void insert(std::ranges::range auto& rows) {
+            for (const auto& row: rows) {
+                if (matches(row)) {
+                    auto& group = groups.try_emplace(gb_projector(row)).first->second;
+                    add(group, projector(row), std::make_index_sequence<std::tuple_size_v<PTuple>>());
+                }
+            }
+        }
+
+        // every erased row must have been inserted before
+        void erase(std::ranges::range auto& rows) {
+            for (const auto& row: rows) {
+                if (matches(row)) {
+                    auto pos = groups.find(gb_projector(row));
+                    if (pos == groups.end()) {
+                        throw std::runtime_error("erasing a row that is not in the view");
+                    }
+                    remove(pos->second, projector(row), std::make_index_sequence<std::tuple_size_v<PTuple>>());
+                    if (pos->second.rows == 0) {
+                        groups.erase(pos);
+                    }
+                }
+            }
+        }
+
+        std::size_t num_groups() const { return groups.size(); }
+
+        // the current query result, with ORDER BY / LIMIT applied
+        std::generator<ResultType> result() const {
+            if constexpr (QP::has_order_by or QP::has_limit) {
+                auto reduced = current();
+                co_yield std::ranges::elements_of(QP::order_limit(reduced));
+            } else {
+                co_yield std::ranges::elements_of(current());
+            }
+        }
+
+    private:
+        static constexpr auto projector = QP::projector.value();
+
+        template<std::size_t Idx>
+        using Extrema = std::conditional_t<QP::agg_ops[Idx] == AggOp::MIN or QP::agg_ops[Idx] == AggOp::MAX,
+                                           std::multiset<std::tuple_element_t<Idx, PTuple>>, std::monostate>;
+
+        template<std::size_t... Idx>
+        static auto make_extrema(std::index_sequence<Idx...>) -> std::tuple<Extrema<Idx>...>;
+
+        struct Group {
+            PTuple acc = impl::make_tuple_reduction_base<PTuple, QP::agg_ops>();
+            uint64_t rows = 0;
+            decltype(make_extrema(std::make_index_sequence<std::tuple_size_v<PTuple>>())) extrema;
+        };
+
+        std::unordered_map<GBTuple, Group, impl::hash_tuple::hash<GBTuple>> groups;
+
+        static bool matches(const auto& row) {
+            if constexpr (QP::dnf_where_selector) {
+                return QP::dnf_where_selector.value()(row);
+            } else {
+                return true;
+            }
+        }
+
+        template<std::size_t Idx>
+        static void refresh_extreme(Group& group) {
+            const auto& values = std::get<Idx>(group.extrema);
+            if (not values.empty()) {
+                std::get<Idx>(group.acc) = QP::agg_ops[Idx] == AggOp::MIN ? *values.begin() : *values.rbegin();
+            }
+        }
+
+        template<std::size_t... Idx>
+        static void add(Group& group, const PTuple& p, std::index_sequence<Idx...>) {
+            (..., [&]() {
+                constexpr AggOp agg = QP::agg_ops[Idx];
+                if constexpr (agg == AggOp::NONE) {
+                    if (group.rows == 0) {
+                        std::get<Idx>(group.acc) = std::get<Idx>(p);
+                    }
+                } else if constexpr (agg == AggOp::COUNT or agg == AggOp::SUM) {
+                    std::get<Idx>(group.acc) += std::get<Idx>(p);
+                } else {
+                    std::get<Idx>(group.extrema).insert(std::get<Idx>(p));
+                    refresh_extreme<Idx>(group);
+                }
+            }());
+            ++group.rows;
+        }
+
+        template<std::size_t... Idx>
+        static void remove(Group& group, const PTuple& p, std::index_sequence<Idx...>) {
+            (..., [&]() {
+                constexpr AggOp agg = QP::agg_ops[Idx];
+                if constexpr (agg == AggOp::COUNT or agg == AggOp::SUM) {
+                    std::get<Idx>(group.acc) -= std::get<Idx>(p);
+                } else if constexpr (agg == AggOp::MIN or agg == AggOp::MAX) {
+                    auto& values = std::get<Idx>(group.extrema);
+                    auto pos = values.find(std::get<Idx>(p));
+                    if (pos == values.end()) {
+                        throw std::runtime_error("erasing a row that is not in the view");
+                    }
+                    values.erase(pos);
+                    refresh_extreme<Idx>(group);
+                }
+            }());
+            --group.rows;
+        }
+
+        std::generator<PTuple> current() const {
+            if (not has_groups and groups.empty()) {  // a global aggregate always has its one row
+                co_yield impl::make_tuple_reduction_base<PTuple, QP::agg_ops>();
+            }
+            for (const auto& kv: groups) {
+                co_yield kv.second.acc;
+            }
+        }
+    };
+}
+
+#endif //SQL_MATERIALIZED_VIEW_H
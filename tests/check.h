@@ -0,0 +1,64 @@
+#ifndef SQL_TESTS_CHECK_H
+#define SQL_TESTS_CHECK_H
+
+#include <algorithm>
+#include <cstdio>
+#include <ranges>
+#include <vector>
+
+// the checks of the test executables: a failed CHECK is reported and the test goes on; main returns
+// ctsql::test::result(), which ctest reads as failure if any check failed
+
+namespace ctsql::test {
+    inline int failures = 0;
+
+    inline bool check(bool ok, const char* what, const char* file, int line) {
+        if (not ok) {
+            ++failures;
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, what);
+        }
+        return ok;
+    }
+
+    // an expression that must throw E
+    template<typename E, typename F>
+    bool throws(F&& f) {
+        try {
+            f();
+        } catch (const E&) {
+            return true;
+        }
+        return false;
+    }
+
+    // the rows of a query result in sorted order, for comparing results regardless of the order operators emit them in
+    template<std::ranges::range Rows>
+    auto sorted(Rows&& rows) {
+        std::vector<std::ranges::range_value_t<Rows>> out;
+        for (auto&& row: rows) {
+            out.push_back(row);
+        }
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+    template<std::ranges::range Rows>
+    auto collect(Rows&& rows) {
+        std::vector<std::ranges::range_value_t<Rows>> out;
+        for (auto&& row: rows) {
+            out.push_back(row);
+        }
+        return out;
+    }
+
+    inline int result() {
+        if (failures) {
+            std::fprintf(stderr, "%d check(s) failed\n", failures);
+        }
+        return failures ? 1 : 0;
+    }
+}
+
+#define CHECK(cond) ::ctsql::test::check(static_cast<bool>(cond), #cond, __FILE__, __LINE__)
+
+#endif //SQL_TESTS_CHECK_H
@@ -0,0 +1,5 @@
+#include "planner.h"
+#include "registered_queries.h"
+
+CTSQL_DEFINE_QUERY(names_by_x, "SELECT name, x FROM Point WHERE x > 990 ORDER BY x, name", Point);
+CTSQL_DEFINE_QUERY(vec_names, "SELECT x, Vec.name FROM Point, Vec ON Point.x = Vec.x1 WHERE y2 < -5", Point, Vec);
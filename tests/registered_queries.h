@@ -0,0 +1,12 @@
+#ifndef SQL_TESTS_REGISTERED_QUERIES_H
+#define SQL_TESTS_REGISTERED_QUERIES_H
+
+#include "registry.h"
+#include "schemas.h"
+
+// the queries of test_registry, defined in registered_queries.cpp
+
+CTSQL_DECLARE_QUERY(names_by_x, (std::tuple<std::string, int>), Point);
+CTSQL_DECLARE_QUERY(vec_names, (std::tuple<int, std::string>), Point, Vec);
+
+#endif //SQL_TESTS_REGISTERED_QUERIES_H
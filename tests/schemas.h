@@ -0,0 +1,75 @@
+#ifndef SQL_TESTS_SCHEMAS_H
+#define SQL_TESTS_SCHEMAS_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include "refl.hpp"
+#include "common.h"
+
+// the schemas of main.cpp, and generated tables of them
+
+struct Point {
+    Point() = default;
+    Point(int x, int y, std::string name): x{x}, y{y}, name{std::move(name)} {}
+    int x{};
+    int y{};
+    [[nodiscard]] double get_mag() const { return std::sqrt(static_cast<double>(x * x + y * y)); }
+    std::string name;
+};
+
+struct Vec {
+    Vec() = default;
+    Vec(int x1, int y1, int x2, int y2, std::string name): x1{x1}, y1{y1}, x2{x2}, y2{y2}, name{std::move(name)} {}
+    int x1{};
+    int y1{};
+    int x2{};
+    int y2{};
+    std::string name;
+};
+
+REFL_AUTO(
+    type(Point),
+    field(x),
+    field(y),
+    func(get_mag),
+    field(name)
+)
+
+REFL_AUTO(
+    type(Vec),
+    field(x1),
+    field(y1),
+    field(x2),
+    field(y2),
+    field(name)
+)
+
+namespace ctsql::test {
+    // x cycles through [0, x_mod), y through [0, 13); names are 'a'..'g' repeated up to 30 times
+    inline std::vector<SchemaTuple<Point>> points(int n, int x_mod = 997) {
+        std::vector<SchemaTuple<Point>> rows;
+        for (int i = 0; i < n; ++i) {
+            rows.emplace_back(schema_to_tuple(Point(i % x_mod, i % 13, std::string(1 + i % 30, static_cast<char>('a' + i % 7)))));
+        }
+        return rows;
+    }
+
+    inline std::vector<SchemaTuple<Vec>> vecs(int n, int x1_mod = 1500) {
+        std::vector<SchemaTuple<Vec>> rows;
+        for (int i = 0; i < n; ++i) {
+            rows.emplace_back(schema_to_tuple(Vec(i % x1_mod, i % 6, i, -i, std::string(1, static_cast<char>('a' + i % 4)))));
+        }
+        return rows;
+    }
+
+    // an input that is neither sized nor re-iterable, like a stream
+    template<typename T>
+    std::generator<T> stream(const std::vector<T>& rows) {
+        for (const auto& row: rows) {
+            co_yield row;
+        }
+    }
+}
+
+#endif //SQL_TESTS_SCHEMAS_H
@@ -0,0 +1,138 @@
+#include "planner.h"
+#include "check.h"
+#include "schemas.h"
+
+// queries answered together in one scan (process_many, process_batch) give the results of running them one by one
+
+using namespace ctsql;
+using namespace ctsql::test;
+
+static constexpr char filter_query[] = R"(SELECT x, y FROM Point WHERE x > 2 AND name = 'aaa' OR y = 3)";
+using Filter = QueryPlanner<refl::make_const_string(filter_query), Point>;
+static constexpr char grouped_query[] = R"(SELECT name, SUM(x), COUNT(*) FROM Point WHERE x > 2 GROUP BY name ORDER BY name)";
+using Grouped = QueryPlanner<refl::make_const_string(grouped_query), Point>;
+static constexpr char first_query[] = R"(SELECT x FROM Point LIMIT 5)";
+using First = QueryPlanner<refl::make_const_string(first_query), Point>;
+static constexpr char overlap_query[] = R"(SELECT x, y FROM Point WHERE y = 3 OR name = 'b' AND x > 2)";
+using Overlap = QueryPlanner<refl::make_const_string(overlap_query), Point>;
+static constexpr char total_query[] = R"(SELECT SUM(y), COUNT(*), MAX(x) FROM Point WHERE y > 4)";
+using Total = QueryPlanner<refl::make_const_string(total_query), Point>;
+static constexpr char ordered_query[] = R"(SELECT x, y, name FROM Point WHERE x < 500 ORDER BY y DESC, x, name)";
+using Ordered = QueryPlanner<refl::make_const_string(ordered_query), Point>;
+static constexpr char top_query[] = R"(SELECT x, y FROM Point WHERE name <> 'a' ORDER BY x DESC, y LIMIT 7)";
+using Top = QueryPlanner<refl::make_const_string(top_query), Point>;
+static constexpr char groups_query[] = R"(SELECT name, x, COUNT(*) FROM Point GROUP BY name, x)";
+using Groups = QueryPlanner<refl::make_const_string(groups_query), Point>;
+
+static constexpr char routed_query[] = R"(SELECT x, y FROM Point WHERE x > ? AND name = :nm OR y = ? AND name = :nm)";
+using Routed = QueryPlanner<refl::make_const_string(routed_query), Point>;
+static constexpr char unrouted_query[] = R"(SELECT x, y FROM Point WHERE x = ? OR y = ? AND name = 'a')";
+using Unrouted = QueryPlanner<refl::make_const_string(unrouted_query), Point>;
+static constexpr char ranked_query[] = R"(SELECT name, SUM(x) FROM Point WHERE x >= ? GROUP BY name ORDER BY name LIMIT 2)";
+using Ranked = QueryPlanner<refl::make_const_string(ranked_query), Point>;
+static constexpr char converted_query[] = R"(SELECT x, name FROM Point WHERE x = ?)";
+using Converted = QueryPlanner<refl::make_const_string(converted_query), Point>;
+static constexpr char sorted_by_query[] = R"(SELECT x, y FROM Point WHERE y < ? ORDER BY y, x DESC)";
+using SortedBy = QueryPlanner<refl::make_const_string(sorted_by_query), Point>;
+static constexpr char limited_query[] = R"(SELECT x, y FROM Point WHERE y = ? ORDER BY x DESC LIMIT 1000000000)";
+using Limited = QueryPlanner<refl::make_const_string(limited_query), Point>;
+
+// the stream of every binding is the result of the query run under it
+template<typename QP, typename... Ts>
+void check_batch(auto& input, const std::vector<Params<Ts...>>& bindings) {
+    auto streams = process_batch<QP>(input, bindings);
+    CHECK(streams.size() == bindings.size());
+    for (std::size_t i = 0; i < bindings.size(); ++i) {
+        CHECK(collect(streams[i]) == collect(process<QP>(input, bindings[i])));
+    }
+}
+
+void test_process_batch() {
+    auto ps = points(3000, 50);
+    static_assert(impl::BatchScan<Routed, Params<int, std::string, int>>::key.usable);  // on name
+    check_batch<Routed>(ps, std::vector{bind_params(2, std::string("aaa"), 3), bind_params(0, std::string("bb"), 1),
+                                        bind_params(1, std::string("zz"), 1), bind_params(-1, std::string("aaa"), 0)});
+    static_assert(not impl::BatchScan<Unrouted, Params<int, int>>::key.usable);  // OR across columns
+    check_batch<Unrouted>(ps, std::vector{bind_params(1, 2), bind_params(3, 3), bind_params(5, 0)});
+    check_batch<Ranked>(ps, std::vector{bind_params(0), bind_params(3), bind_params(100)});
+    check_batch<Converted>(ps, std::vector{bind_params(2.0), bind_params(2.5), bind_params(3.0), bind_params(2.0)});
+    check_batch<SortedBy>(ps, std::vector{bind_params(0), bind_params(4), bind_params(13)});
+}
+
+// the bindings of a call share one budget
+void test_process_batch_memory() {
+    auto ps = points(20000, 50);
+    set_memory_budget(64 << 10);
+    check_batch<Ranked>(ps, std::vector{bind_params(0), bind_params(25)});
+    CHECK(throws<MemoryBudgetExceeded>([&] { process_batch<SortedBy>(ps, std::vector{bind_params(1), bind_params(13)}); }));
+    // a LIMIT takes memory by the rows kept, not by the limit
+    std::vector<Params<int>> bindings;
+    for (int y = 0; y < 50; ++y) {
+        bindings.push_back(bind_params(y));
+    }
+    auto few = points(200);
+    check_batch<Limited>(few, bindings);
+    set_memory_budget(0);
+
+    collect(process_batch<SortedBy>(ps, std::vector{bind_params(13)})[0]);
+    const std::size_t peak = last_query_memory().peak;
+    set_memory_budget(2 * peak);
+    collect(process_batch<SortedBy>(ps, std::vector{bind_params(13)})[0]);
+    CHECK(throws<MemoryBudgetExceeded>([&] {
+        process_batch<SortedBy>(ps, std::vector{bind_params(13), bind_params(13), bind_params(13)});
+    }));
+    set_memory_budget(0);
+}
+
+void test_process_many() {
+    auto ps = points(3000);
+    static_assert(impl::SharedScan<Filter, Grouped, First, Overlap>::size == 4);  // y = 3 and x > 2 are shared
+    auto [filter, grouped, first, overlap] = process_many<Filter, Grouped, First, Overlap>(ps);
+    CHECK(sorted(filter) == sorted(process<Filter>(ps)));
+    CHECK(collect(grouped) == collect(process<Grouped>(ps)));
+    CHECK(collect(first) == collect(process<First>(ps)));
+    CHECK(sorted(overlap) == sorted(process<Overlap>(ps)));
+    auto [total, ordered, top, groups] = process_many<Total, Ordered, Top, Groups>(ps);
+    CHECK(collect(total) == collect(process<Total>(ps)));
+    CHECK(collect(ordered) == collect(process<Ordered>(ps)));
+    CHECK(collect(top) == collect(process<Top>(ps)));
+    CHECK(sorted(groups) == sorted(process<Groups>(ps)));
+    // a stream is read once for all of the queries
+    auto rows = stream(ps);
+    auto [f, o] = process_many<Filter, Overlap>(rows);
+    CHECK(sorted(f) == sorted(process<Filter>(ps)));
+    CHECK(sorted(o) == sorted(process<Overlap>(ps)));
+}
+
+// each query keeps what its result needs, in memory accounted to the call
+void test_process_many_memory() {
+    auto ps = points(20000);
+    auto expected = sorted(process<Groups>(ps));
+    const std::size_t peak = last_query_memory().peak;
+    set_memory_budget(peak / 10);
+    {
+        auto [total, top, first, groups] = process_many<Total, Top, First, Groups>(ps);
+        CHECK(sorted(groups) == expected);
+        CHECK(last_query_memory().spilled > 0 and last_query_memory().peak <= peak / 10);  // of all four
+        CHECK(collect(total) == collect(process<Total>(ps)));
+        CHECK(collect(top) == collect(process<Top>(ps)));
+        CHECK(collect(first) == collect(process<First>(ps)));
+    }
+    CHECK(throws<MemoryBudgetExceeded>([&] { process_many<Total, Ordered>(ps); }));
+    set_memory_budget(0);
+
+    auto [alone] = process_many<Ordered>(ps);
+    collect(alone);
+    const std::size_t ordered = last_query_memory().peak;
+    auto [with_total, total] = process_many<Ordered, Total>(ps);
+    collect(with_total);
+    CHECK(ordered > 0 and last_query_memory().peak == ordered);  // not that of Total, the last one
+}
+
+int main() {
+    test_process_many();
+    test_process_many_memory();
+    test_process_batch();
+    test_process_batch_memory();
+    return result();
+}
@@ -0,0 +1,82 @@
+#include <map>
+#include "runtime/catalog.h"
+#include "check.h"
+#include "schemas.h"
+
+// queries known only at run time (runtime/catalog.h), against the rows computed by hand
+
+using namespace ctsql;
+using namespace ctsql::test;
+
+void test_runtime_queries() {
+    auto ps = points(500, 50);
+    Catalog catalog;
+    catalog.register_table<Point>(ps);
+
+    std::vector<Row> expected;
+    for (const auto& p: ps) {
+        if (std::get<0>(p) > 45 and std::get<1>(p) < 3) {
+            expected.push_back({int64_t{std::get<0>(p)}, int64_t{std::get<1>(p)}});
+        }
+    }
+    CHECK(not expected.empty());
+    CHECK(collect(catalog.query("SELECT x, y FROM Point WHERE x > 45 AND y < 3")) == expected);
+    CHECK(collect(catalog.query("SELECT x, y FROM Point WHERE x > 45 AND y < 3 LIMIT 2")) == std::vector(expected.begin(), expected.begin() + 2));
+
+    std::map<int64_t, std::pair<int64_t, int64_t>> groups;  // SUM(x), COUNT(*) by y
+    for (const auto& p: ps) {
+        auto& [sum, count] = groups[std::get<1>(p)];
+        sum += std::get<0>(p);
+        ++count;
+    }
+    expected.clear();
+    for (const auto& [y, g]: groups) {
+        expected.push_back({y, g.first, g.second});
+    }
+    CHECK(collect(catalog.query("SELECT y, SUM(x), COUNT(*) FROM Point GROUP BY y ORDER BY y")) == expected);
+    CHECK(collect(catalog.query("SELECT y, SUM(x), COUNT(*) FROM Point GROUP BY y ORDER BY y DESC LIMIT 1")) == std::vector<Row>{expected.back()});
+    CHECK(throws<std::runtime_error>([&] { catalog.query("SELECT x FROM Nowhere"); }));
+}
+
+// re-registering a table drops the plans over its old rows, and only those
+void test_plan_cache() {
+    auto ps = points(100);
+    auto vs = vecs(100);
+    Catalog catalog;
+    catalog.register_table<Point>(ps);
+    catalog.register_table<Vec>(vs);
+    CHECK(collect(catalog.query("SELECT COUNT(*) FROM Point")) == std::vector<Row>{Row{int64_t{100}}});
+    catalog.prepare("SELECT   COUNT(*)  FROM Point");  // the same plan
+    catalog.prepare("SELECT x1 FROM Vec");
+    CHECK(catalog.num_cached_plans() == 2);
+
+    auto more = points(150);
+    catalog.register_table<Point>(more);
+    CHECK(catalog.num_cached_plans() == 1);
+    CHECK(collect(catalog.query("SELECT COUNT(*) FROM Point")) == std::vector<Row>{Row{int64_t{150}}});
+    CHECK(catalog.num_cached_plans() == 2);
+    catalog.clear_cached_plans();
+    CHECK(catalog.num_cached_plans() == 0);
+}
+
+// past its capacity, the cache drops the plan used least recently
+void test_plan_cache_capacity() {
+    auto ps = points(100);
+    Catalog catalog(2);
+    catalog.register_table<Point>(ps);
+    auto count = catalog.prepare("SELECT COUNT(*) FROM Point");
+    auto x = catalog.prepare("SELECT x FROM Point");
+    CHECK(catalog.prepare("SELECT COUNT(*) FROM Point") == count);  // used again
+    catalog.prepare("SELECT y FROM Point");  // drops SELECT x
+    CHECK(catalog.num_cached_plans() == 2);
+    CHECK(catalog.prepare("SELECT COUNT(*) FROM Point") == count);
+    CHECK(catalog.prepare("SELECT x FROM Point") != x);  // planned anew
+    CHECK(collect(impl::run_plan(count)) == std::vector<Row>{Row{int64_t{100}}});
+}
+
+int main() {
+    test_runtime_queries();
+    test_plan_cache();
+    test_plan_cache_capacity();
+    return result();
+}
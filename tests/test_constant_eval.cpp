@@ -0,0 +1,72 @@
+#include <array>
+#include "planner.h"
+#include "check.h"
+
+// queries answered in constant evaluation (constexpr_process) give the rows of process over the same input
+
+struct Sample {
+    int k{};
+    int v{};
+    double w{};
+    std::string_view tag;
+};
+
+REFL_AUTO(type(Sample), field(k), field(v), field(w), field(tag))
+
+using namespace ctsql;
+using namespace ctsql::test;
+
+static constexpr std::array<Sample, 8> samples{{
+    {1, 5, 0.5, "a"}, {2, 3, 1.5, "b"}, {1, 7, 2.0, "a"}, {3, 1, 0.25, "c"},
+    {2, 9, 1.0, "b"}, {1, 2, 3.0, "c"}, {3, 4, 0.75, "a"}, {2, 6, 2.5, "b"}
+}};
+
+static constexpr char filter_query[] = R"(SELECT k, v FROM Sample WHERE v > 3 AND k < 3 OR w = 0.25)";
+using Filter = QueryPlanner<refl::make_const_string(filter_query), Sample>;
+static constexpr char grouped_query[] = R"(SELECT k, SUM(v), COUNT(*), MAX(w) FROM Sample WHERE v <> 2 GROUP BY k ORDER BY k DESC)";
+using Grouped = QueryPlanner<refl::make_const_string(grouped_query), Sample>;
+static constexpr char top_query[] = R"(SELECT v, w FROM Sample ORDER BY w DESC, v LIMIT 3)";
+using Top = QueryPlanner<refl::make_const_string(top_query), Sample>;
+static constexpr char total_query[] = R"(SELECT SUM(v), MIN(w) FROM Sample WHERE k > 5)";
+using Total = QueryPlanner<refl::make_const_string(total_query), Sample>;
+static constexpr char tags_query[] = R"(SELECT tag, v FROM Sample WHERE tag = 'a' ORDER BY v)";
+using Tags = QueryPlanner<refl::make_const_string(tags_query), Sample>;
+
+static constexpr auto filtered = constexpr_process<Filter, samples>();
+static_assert(filtered.size() == 5 and filtered[0] == std::tuple(1, 5) and filtered[3] == std::tuple(2, 9));
+
+static constexpr auto grouped = constexpr_process<Grouped, samples>();
+static_assert(grouped.size() == 3);
+static_assert(grouped[0] == std::tuple(3, 5, 2, 0.75));
+static_assert(grouped[1] == std::tuple(2, 18, 3, 2.5));
+static_assert(grouped[2] == std::tuple(1, 12, 2, 2.0));
+
+static constexpr auto top = constexpr_process<Top, samples>();
+static_assert(top.size() == 3 and top[0] == std::tuple(2, 3.0) and top[1] == std::tuple(6, 2.5) and top[2] == std::tuple(7, 2.0));
+
+// a global aggregate has a row even over no input
+static constexpr auto total = constexpr_process<Total, samples>();
+static_assert(total.size() == 1 and std::get<0>(total[0]) == 0);
+
+static constexpr auto tags = constexpr_process<Tags, samples>();
+static_assert(tags.size() == 3 and tags[0] == std::tuple(std::string_view("a"), 4) and tags[2] == std::tuple(std::string_view("a"), 7));
+
+static_assert(not impl::is_constant_row<std::tuple<int, std::string>>::value);
+
+template<typename QP>
+void check_same(const auto& constant) {
+    std::vector<SchemaTuple<Sample>> rows;
+    for (const Sample& s: samples) {
+        rows.push_back(schema_to_tuple(s));
+    }
+    CHECK(collect(process<QP>(rows)) == std::vector(constant.begin(), constant.end()));
+}
+
+int main() {
+    check_same<Filter>(filtered);
+    check_same<Grouped>(grouped);
+    check_same<Top>(top);
+    check_same<Total>(total);
+    check_same<Tags>(tags);
+    return result();
+}
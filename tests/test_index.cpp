@@ -0,0 +1,168 @@
+#include <limits>
+#include "planner.h"
+#include "index/hash_index.h"
+#include "index/sorted_index.h"
+#include "index/zone_map.h"
+#include "check.h"
+#include "schemas.h"
+
+// access paths over indexed tables (index/): whichever one a query takes, it gives the rows of a full scan
+
+struct Reading {
+    int id{};
+    float f{};
+    double d{};
+};
+
+REFL_AUTO(type(Reading), field(id), field(f), field(d))
+
+using namespace ctsql;
+using namespace ctsql::test;
+using impl::WhereCNF;
+
+static constexpr char range_query[] = R"(SELECT x, y FROM Point WHERE x >= 2 AND x < 5 AND y <> 3)";
+using Range = QueryPlanner<refl::make_const_string(range_query), Point>;
+static constexpr char either_query[] = R"(SELECT x, y FROM Point WHERE x = 3 OR y = 1)";
+using Either = QueryPlanner<refl::make_const_string(either_query), Point>;
+static constexpr char range_join_query[] = R"(SELECT Point.x, Vec.x2 FROM Point, Vec ON Point.name = Vec.name WHERE x2 > 4 AND x2 <= 15.5 AND x > 1)";
+using RangeJoin = QueryPlanner<refl::make_const_string(range_join_query), Point, Vec>;
+static constexpr char lookup_query[] = R"(SELECT x, y FROM Point WHERE name = 'ee' AND x = 4 AND y <> 3)";
+using Lookup = QueryPlanner<refl::make_const_string(lookup_query), Point>;
+static constexpr char partial_key_query[] = R"(SELECT x, y FROM Point WHERE x = 4 AND y <> 3)";
+using PartialKey = QueryPlanner<refl::make_const_string(partial_key_query), Point>;
+static constexpr char index_join_query[] = R"(SELECT Point.x, Vec.x2 FROM Point, Vec ON Point.name = Vec.name AND Point.x < Vec.x2 WHERE x2 > 4 AND x > 1)";
+using IndexJoin = QueryPlanner<refl::make_const_string(index_join_query), Point, Vec>;
+
+static constexpr char float_query[] = R"(SELECT id FROM Reading WHERE f = 0.1)";
+using FloatEq = QueryPlanner<refl::make_const_string(float_query), Reading>;
+static constexpr char exact_float_query[] = R"(SELECT id FROM Reading WHERE f = 0.5)";
+using ExactFloatEq = QueryPlanner<refl::make_const_string(exact_float_query), Reading>;
+static constexpr char wide_int_query[] = R"(SELECT id FROM Reading WHERE id = 4294967297)";
+using WideIntEq = QueryPlanner<refl::make_const_string(wide_int_query), Reading>;
+static constexpr char int_query[] = R"(SELECT id FROM Reading WHERE id = 1)";
+using IntEq = QueryPlanner<refl::make_const_string(int_query), Reading>;
+
+static constexpr char clustered_query[] = R"(SELECT x, y FROM Point WHERE x >= 200 AND x < 300 AND y <> 3 OR name = 'j')";
+using Clustered = QueryPlanner<refl::make_const_string(clustered_query), Point>;
+static constexpr char unclustered_query[] = R"(SELECT x, y FROM Point WHERE x > 100 AND x < 600 AND y > 1 AND get_mag > 10.5)";
+using Unclustered = QueryPlanner<refl::make_const_string(unclustered_query), Point>;
+static constexpr char zone_join_query[] = R"(SELECT Point.x, Vec.x1 FROM Point, Vec ON Point.name = Vec.name WHERE x1 < 40 AND x < 100)";
+using ZoneJoin = QueryPlanner<refl::make_const_string(zone_join_query), Point, Vec>;
+static constexpr char above_query[] = R"(SELECT id FROM Reading WHERE d > 5)";
+using Above = QueryPlanner<refl::make_const_string(above_query), Reading>;
+static constexpr char within_query[] = R"(SELECT id FROM Reading WHERE d >= 0 AND d < 100)";
+using Within = QueryPlanner<refl::make_const_string(within_query), Reading>;
+static constexpr char unequal_query[] = R"(SELECT id FROM Reading WHERE d <> 1)";
+using Unequal = QueryPlanner<refl::make_const_string(unequal_query), Reading>;
+
+std::vector<SchemaTuple<Reading>> readings() {
+    std::vector<SchemaTuple<Reading>> rows;
+    for (int i = 0; i < 8; ++i) {
+        rows.emplace_back(i, i % 2 ? 0.1f : 0.5f, i * 0.5);
+    }
+    return rows;
+}
+
+void test_sorted_index() {
+    auto ps = points(400, 7);
+    SortedIndex<Point, refl::make_const_string("x")> index(ps);
+    auto indexed = with_index(ps, index);
+    static_assert(impl::choose_access_path<Point, WhereCNF<Range>, decltype(indexed)>() == impl::AccessPath::RANGE_SCAN);
+    static_assert(impl::choose_access_path<Point, WhereCNF<Either>, decltype(indexed)>() == impl::AccessPath::FULL_SCAN);
+    CHECK(not collect(process<Range>(indexed)).empty());
+    CHECK(sorted(process<Range>(indexed)) == sorted(process<Range>(ps)));
+    CHECK(sorted(process<Either>(indexed)) == sorted(process<Either>(ps)));
+    auto vs = vecs(100);
+    SortedIndex<Vec, refl::make_const_string("x2")> vindex(vs);
+    auto vindexed = with_index(vs, vindex);
+    CHECK(sorted(process<RangeJoin>(ps, vindexed)) == sorted(process<RangeJoin>(ps, vs)));
+}
+
+void test_hash_index() {
+    auto ps = points(400, 7);
+    HashIndex<Point, refl::make_const_string("x"), refl::make_const_string("name")> index(ps);
+    auto indexed = with_index(ps, index);
+    static_assert(impl::choose_access_path<Point, WhereCNF<Lookup>, decltype(indexed)>() == impl::AccessPath::POINT_LOOKUP);
+    static_assert(impl::choose_access_path<Point, WhereCNF<PartialKey>, decltype(indexed)>() == impl::AccessPath::FULL_SCAN);
+    CHECK(not collect(process<Lookup>(indexed)).empty());
+    CHECK(sorted(process<Lookup>(indexed)) == sorted(process<Lookup>(ps)));
+    CHECK(sorted(process<PartialKey>(indexed)) == sorted(process<PartialKey>(ps)));
+    auto vs = vecs(100);
+    HashIndex<Vec, refl::make_const_string("name")> vindex(vs);
+    auto vindexed = with_index(vs, vindex);
+    CHECK(sorted(process<IndexJoin>(ps, vindexed)) == sorted(process<IndexJoin>(ps, vs)));
+    // an index that is behind its table is refused
+    ps.emplace_back(schema_to_tuple(Point(4, 1, "ee")));
+    CHECK(throws<std::runtime_error>([&] { collect(process<Lookup>(indexed)); }));
+    index.append(ps);
+    CHECK(sorted(process<Lookup>(indexed)) == sorted(process<Lookup>(ps)));
+}
+
+// a literal the key type cannot hold equals no row; its conversion to the key must not be looked up instead
+void test_inexact_literals() {
+    auto rs = readings();
+    HashIndex<Reading, refl::make_const_string("f")> findex(rs);
+    auto by_f = with_index(rs, findex);
+    static_assert(impl::choose_access_path<Reading, WhereCNF<FloatEq>, decltype(by_f)>() == impl::AccessPath::FULL_SCAN);
+    static_assert(impl::choose_access_path<Reading, WhereCNF<ExactFloatEq>, decltype(by_f)>() == impl::AccessPath::POINT_LOOKUP);
+    CHECK(collect(process<FloatEq>(rs)).empty());  // 0.1f is not 0.1
+    CHECK(collect(process<FloatEq>(by_f)).empty());
+    CHECK(sorted(process<ExactFloatEq>(by_f)) == sorted(process<ExactFloatEq>(rs)));
+    CHECK(collect(process<ExactFloatEq>(by_f)).size() == 4);
+
+    HashIndex<Reading, refl::make_const_string("id")> iindex(rs);
+    auto by_id = with_index(rs, iindex);
+    static_assert(impl::choose_access_path<Reading, WhereCNF<WideIntEq>, decltype(by_id)>() == impl::AccessPath::FULL_SCAN);
+    static_assert(impl::choose_access_path<Reading, WhereCNF<IntEq>, decltype(by_id)>() == impl::AccessPath::POINT_LOOKUP);
+    CHECK(collect(process<WideIntEq>(by_id)).empty());  // not id 1, which 4294967297 wraps to
+    CHECK(collect(process<IntEq>(by_id)).size() == 1);
+}
+
+void test_zone_map() {
+    std::vector<SchemaTuple<Point>> ps;
+    for (int i = 0; i < 1000; ++i) {
+        ps.emplace_back(schema_to_tuple(Point(i, i % 13, std::string(1, static_cast<char>('a' + i / 100)))));
+    }
+    ZoneMap<Point, 64> zones(ps);
+    auto indexed = with_index(ps, zones);
+    static_assert(impl::choose_access_path<Point, WhereCNF<Clustered>, decltype(indexed)>() == impl::AccessPath::ZONE_SCAN);
+    CHECK(sorted(process<Clustered>(indexed)) == sorted(process<Clustered>(ps)));
+    CHECK(sorted(process<Unclustered>(indexed)) == sorted(process<Unclustered>(ps)));
+    auto vs = vecs(300, 300);
+    ZoneMap<Vec, 16> vzones(vs);
+    auto vindexed = with_index(vs, vzones);
+    CHECK(sorted(process<ZoneJoin>(indexed, vindexed)) == sorted(process<ZoneJoin>(ps, vs)));
+    // a partial last block is summarized again as rows are appended
+    for (int i = 1000; i < 1100; ++i) {
+        ps.emplace_back(schema_to_tuple(Point(i, i % 13, "j")));
+    }
+    zones.append(ps);
+    CHECK(zones.num_blocks() == (1100 + 63) / 64);
+    CHECK(sorted(process<Clustered>(indexed)) == sorted(process<Clustered>(ps)));
+}
+
+// NaNs match no comparison but <>, and must neither hide the other rows of their block nor be taken for a match
+void test_zone_map_nan() {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<SchemaTuple<Reading>> rs;
+    for (double d: {nan, 10.0, 1.0, 2.0,  nan, nan, nan, nan,  1.0, 1.0, nan, 1.0,  3.0, 4.0, 5.0, 6.0}) {
+        rs.emplace_back(static_cast<int>(rs.size()), 0.0f, d);
+    }
+    ZoneMap<Reading, 4> zones(rs);
+    auto indexed = with_index(rs, zones);
+    static_assert(impl::choose_access_path<Reading, WhereCNF<Above>, decltype(indexed)>() == impl::AccessPath::ZONE_SCAN);
+    CHECK(collect(process<Above>(rs)).size() == 2);
+    CHECK(sorted(process<Above>(indexed)) == sorted(process<Above>(rs)));
+    CHECK(sorted(process<Within>(indexed)) == sorted(process<Within>(rs)));
+    CHECK(sorted(process<Unequal>(indexed)) == sorted(process<Unequal>(rs)));
+    CHECK(std::get<2>(zones.zone(1)).all_nan and std::get<2>(zones.zone(2)).has_nan);
+}
+
+int main() {
+    test_sorted_index();
+    test_hash_index();
+    test_inexact_literals();
+    test_zone_map();
+    test_zone_map_nan();
+    return result();
+}
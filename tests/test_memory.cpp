@@ -0,0 +1,155 @@
+#include <string_view>
+#include "planner.h"
+#include "check.h"
+#include "schemas.h"
+
+// memory accounting and budgets (operator/memory.h), and spilling to disk over the budget (operator/spill.h):
+// a query run under a budget gives the same rows as without one, or fails with MemoryBudgetExceeded
+
+struct Tag {
+    std::string_view name;
+    int v{};
+};
+
+struct Label {
+    std::string_view bname;
+    int w{};
+};
+
+REFL_AUTO(type(Tag), field(name), field(v))
+REFL_AUTO(type(Label), field(bname), field(w))
+
+using namespace ctsql;
+using namespace ctsql::test;
+
+static_assert(impl::Spillable<SchemaTuple<Point>> and impl::Spillable<Point> and impl::Spillable<std::pair<std::tuple<int>, std::string>>);
+static_assert(not impl::Spillable<std::string_view> and not impl::Spillable<SchemaTuple<Tag>> and not impl::Spillable<Tag>);
+
+static constexpr char aggregate_query[] = R"(SELECT name, x, SUM(y), COUNT(*) FROM Point GROUP BY name, x)";
+using Aggregate = QueryPlanner<refl::make_const_string(aggregate_query), Point>;
+static constexpr char equi_join_query[] = R"(SELECT x, x1, y2 FROM Point, Vec ON Point.x = Vec.x1 WHERE y2 < 0)";
+using EquiJoin = QueryPlanner<refl::make_const_string(equi_join_query), Point, Vec>;
+static constexpr char skewed_join_query[] = R"(SELECT x, x2 FROM Point, Vec ON Point.name = Vec.name)";
+using SkewedJoin = QueryPlanner<refl::make_const_string(skewed_join_query), Point, Vec>;
+static constexpr char loop_join_query[] = R"(SELECT x, x1 FROM Point, Vec ON x < x1)";
+using LoopJoin = QueryPlanner<refl::make_const_string(loop_join_query), Point, Vec>;
+static constexpr char ordered_query[] = R"(SELECT name, x FROM Point ORDER BY name, x)";
+using Ordered = QueryPlanner<refl::make_const_string(ordered_query), Point>;
+static constexpr char top_query[] = R"(SELECT x, y FROM Point ORDER BY x DESC, y LIMIT 5)";
+using Top = QueryPlanner<refl::make_const_string(top_query), Point>;
+static constexpr char view_join_query[] = R"(SELECT v, w FROM Tag, Label ON Tag.name = Label.bname)";
+using ViewJoin = QueryPlanner<refl::make_const_string(view_join_query), Tag, Label>;
+static constexpr char view_aggregate_query[] = R"(SELECT name, COUNT(*) FROM Tag GROUP BY name)";
+using ViewAggregate = QueryPlanner<refl::make_const_string(view_aggregate_query), Tag>;
+
+// runs f under a budget of bytes, and restores no limit
+template<typename F>
+auto with_budget(std::size_t bytes, F&& f) {
+    set_memory_budget(bytes);
+    struct Reset {
+        ~Reset() { set_memory_budget(0); }
+    } reset;
+    return f();
+}
+
+void test_codec() {
+    impl::OperatorMemory memory("test");
+    impl::SpillFile file(memory);
+    file.write(Point(3, -4, std::string(200, 'z')));
+    file.write(Point(0, 0, ""));
+    std::vector<Point> back;
+    for (auto&& p: file.rows<Point>()) {
+        back.push_back(p);
+    }
+    CHECK(back.size() == 2);
+    CHECK(back[0].x == 3 and back[0].y == -4 and back[0].name == std::string(200, 'z'));
+    CHECK(back[1].x == 0 and back[1].name.empty());
+    CHECK(memory.usage().spilled == (4 + 4 + 2 + 200) + (4 + 4 + 1));  // a varint of 2 bytes for 200, of 1 for 0
+}
+
+void test_accounting() {
+    auto ps = points(40);
+    auto vs = vecs(20);
+    auto rows = sorted(process<EquiJoin>(ps, vs));
+    const MemoryUsage usage = last_query_memory();
+    CHECK(usage.peak > 0 and usage.current == 0 and usage.spilled == 0);
+    // without spilling, the nested loop join cannot go under the size of its materialized side
+    auto ls = stream(ps);
+    auto rs = stream(vs);
+    CHECK(throws<MemoryBudgetExceeded>([&] { with_budget(64, [&] { return sorted(process<LoopJoin>(ls, rs)); }); }));
+    CHECK(last_query_memory().current == 0);
+    CHECK(with_budget(usage.peak, [&] { return sorted(process<EquiJoin>(ps, vs)); }) == rows);
+}
+
+// ORDER BY holds its rows; under a LIMIT, only the best of them
+void test_sort() {
+    auto ps = points(2000);
+    auto rows = collect(process<Ordered>(ps));
+    CHECK(rows.size() == ps.size() and std::is_sorted(rows.begin(), rows.end()));
+    CHECK(last_query_memory().peak >= ps.size() * sizeof(rows[0]) and last_query_memory().current == 0);
+    CHECK(throws<MemoryBudgetExceeded>([&] { with_budget(4096, [&] { return collect(process<Ordered>(ps)); }); }));
+    auto top = collect(process<Top>(ps));
+    CHECK(top.size() == 5 and std::get<0>(top[0]) == 996 and std::get<0>(top[4]) == 994);
+    CHECK(with_budget(4096, [&] { return collect(process<Top>(ps)); }) == top);
+}
+
+void test_spilled_aggregate() {
+    auto ps = points(20000);
+    auto expected = sorted(process<Aggregate>(ps));
+    const std::size_t peak = last_query_memory().peak;
+    CHECK(expected.size() == 20000);
+    CHECK(with_budget(peak / 10, [&] { return sorted(process<Aggregate>(ps)); }) == expected);
+    CHECK(last_query_memory().spilled > 0 and last_query_memory().peak <= peak / 10);
+}
+
+void test_grace_join() {
+    auto ps = points(20000);
+    auto vs = vecs(3000);
+    auto expected = sorted(process<EquiJoin>(ps, vs));
+    const std::size_t peak = last_query_memory().peak;
+    CHECK(expected.size() == 39979);
+    // builds on Vec, the smaller side; partitions of Vec are split again at this budget
+    CHECK(with_budget(peak / 20, [&] { return sorted(process<EquiJoin>(ps, vs)); }) == expected);
+    CHECK(last_query_memory().spilled > 0 and last_query_memory().peak <= peak / 20);
+    // builds on Point, by the estimates given for the streams
+    auto ls = stream(ps);
+    auto rs = stream(vs);
+    CHECK(with_budget(peak / 20, [&] { return sorted(process<EquiJoin>(ls, rs, 100, 1000000)); }) == expected);
+    // rows of one key cannot be split
+    std::vector<SchemaTuple<Point>> same_l;
+    std::vector<SchemaTuple<Vec>> same_r;
+    for (int i = 0; i < 2000; ++i) {
+        same_l.emplace_back(schema_to_tuple(Point(i, i, "k")));
+        same_r.emplace_back(schema_to_tuple(Vec(i, i, i, i, "k")));
+    }
+    CHECK(sorted(process<SkewedJoin>(same_l, same_r)).size() == 2000 * 2000);
+    CHECK(throws<MemoryBudgetExceeded>([&] { with_budget(last_query_memory().peak / 4, [&] { return sorted(process<SkewedJoin>(same_l, same_r)); }); }));
+}
+
+// string_view columns are not written to disk: over the budget, the query fails rather than answer from empty strings
+void test_unspillable() {
+    std::vector<std::string> names;
+    for (int i = 0; i < 2000; ++i) {
+        names.push_back("key" + std::to_string(i));
+    }
+    std::vector<SchemaTuple<Tag>> tags;
+    std::vector<SchemaTuple<Label>> labels;
+    for (int i = 0; i < 2000; ++i) {
+        tags.emplace_back(names[i], i);
+        labels.emplace_back(names[i], -i);
+    }
+    CHECK(sorted(process<ViewJoin>(tags, labels)).size() == 2000);
+    CHECK(sorted(process<ViewAggregate>(tags)).size() == 2000);
+    CHECK(throws<MemoryBudgetExceeded>([&] { with_budget(65536, [&] { return sorted(process<ViewJoin>(tags, labels)); }); }));
+    CHECK(throws<MemoryBudgetExceeded>([&] { with_budget(65536, [&] { return sorted(process<ViewAggregate>(tags)); }); }));
+}
+
+int main() {
+    test_codec();
+    test_accounting();
+    test_sort();
+    test_spilled_aggregate();
+    test_grace_join();
+    test_unspillable();
+    return result();
+}
@@ -0,0 +1,168 @@
+#include <sstream>
+#include "planner.h"
+#include "check.h"
+#include "schemas.h"
+
+// what a query reports about itself: its plan at compile time (explain), and when built with the CMake definitions of
+// this test, its per-operator statistics (profile/instrument.h), hardware counts and trace timeline
+
+CTSQL_COUNT_ALLOCATIONS()
+
+using namespace ctsql;
+using namespace ctsql::test;
+
+static constexpr char joined_query[] = R"(SELECT Point.name, COUNT(*), SUM(x2) FROM Point, Vec ON Point.x = Vec.x1 WHERE y < 10 AND x2 > 3 GROUP BY Point.name ORDER BY Point.name LIMIT 3)";
+using Joined = QueryPlanner<refl::make_const_string(joined_query), Point, Vec>;
+
+static_assert(impl::instrumented and impl::count_events and impl::tracing, "built without the definitions of test_profile");
+
+// the operator nodes of a profile, depth first
+void flatten(const PlanNode& node, std::vector<const PlanNode*>& nodes) {
+    nodes.push_back(&node);
+    for (const auto& c: node.children) {
+        flatten(*c, nodes);
+    }
+}
+
+const PlanNode* find(const std::vector<const PlanNode*>& nodes, std::string_view name, std::string_view detail = "") {
+    for (const PlanNode* n: nodes) {
+        if (n->name == name and n->detail == detail) {
+            return n;
+        }
+    }
+    return nullptr;
+}
+
+std::size_t occurrences(const std::string& text, std::string_view what) {
+    std::size_t n = 0;
+    for (auto pos = text.find(what); pos != std::string::npos; pos = text.find(what, pos + 1)) {
+        ++n;
+    }
+    return n;
+}
+
+// every operator counts the rows it reads and yields, as computed by hand
+void test_profile() {
+    auto ps = points(600, 300);
+    auto vs = vecs(400, 300);
+    std::size_t left = 0, right = 0, joined = 0;
+    for (const auto& p: ps) {
+        left += std::get<1>(p) < 10;
+    }
+    for (const auto& v: vs) {
+        right += std::get<2>(v) > 3;
+        for (const auto& p: ps) {
+            joined += std::get<1>(p) < 10 and std::get<2>(v) > 3 and std::get<0>(p) == std::get<0>(v);
+        }
+    }
+    CHECK(collect(process<Joined>(ps, vs)).size() == 3);
+    auto profile = last_profile();
+    CHECK(profile != nullptr);
+    if (not profile) {
+        return;
+    }
+    CHECK(profile->name == "query" and profile->detail == Joined::sql and profile->query_id == Joined::query_id);
+    CHECK(profile->input_rows() == ps.size() + vs.size() and profile->rows_out == 3);
+    CHECK(profile->bytes > 0 and profile->self_bytes() <= profile->bytes and profile->self_time() <= profile->time);
+
+    std::vector<const PlanNode*> nodes;
+    flatten(*profile, nodes);
+    CHECK(nodes.size() == 7);
+    const PlanNode* top = find(nodes, "top n");
+    const PlanNode* aggregate = find(nodes, "hash aggregate");
+    const PlanNode* join = find(nodes, "hash join");
+    CHECK(top and aggregate and join and find(nodes, "build", "Point"));
+    if (top and aggregate and join) {
+        CHECK(top->rows_out == 3 and top->input_rows() == aggregate->rows_out);
+        CHECK(aggregate->input_rows() == joined and join->rows_out == joined);
+        CHECK(join->input_rows() == left + right);
+    }
+    const PlanNode* point_scan = find(nodes, "scan", "Point");
+    const PlanNode* vec_scan = find(nodes, "scan", "Vec");
+    CHECK(point_scan and point_scan->input_rows() == ps.size() and point_scan->rows_out == left);
+    CHECK(vec_scan and vec_scan->input_rows() == vs.size() and vec_scan->rows_out == right);
+}
+
+// the plan of process, at compile time
+void test_explain() {
+    constexpr std::string_view plan = Joined::explain();
+    static_assert(plan.starts_with("query [") and plan.find("top n [Point.name ASC; limit 3]") != plan.npos);
+    static_assert(plan.find("hash aggregate [group by Point.name; Point.name, COUNT(*), SUM(Vec.x2)]") != plan.npos);
+    static_assert(plan.find("hash join [Point.x = Vec.x1; where: 2 CNF clauses, 1 pushed to Point, 1 to Vec") != plan.npos);
+    static_assert(plan.find("scan [Point; filter: Point.y < 10]") != plan.npos and plan.find("scan [Vec; filter: Vec.x2 > 3]") != plan.npos);
+    // literals too large to scale to 6 decimals in an int64_t
+    static_assert(impl::explain_number(1e13 + 0.25) == "10000000000000.25" and impl::explain_number(-9.9999999) == "-10");
+    static_assert(impl::explain_number(2.5e30) == "2.5e30" and impl::explain_number(0.125) == "0.125");
+
+    auto ps = points(600, 300);
+    auto vs = vecs(400, 300);
+    HashIndex<Vec, refl::make_const_string("x1")> index(vs);
+    auto indexed = with_index(vs, index);
+    constexpr std::string_view indexed_plan = Joined::explain<decltype(ps), decltype(indexed)>();
+    static_assert(indexed_plan.find("index join") != indexed_plan.npos and indexed_plan.find("hash join") == indexed_plan.npos);
+    CHECK(collect(process<Joined>(ps, indexed)) == collect(process<Joined>(ps, vs)));
+}
+
+// counts are there if the kernel grants them, and never make a profile fail
+void test_counters() {
+    const bool available = impl::PerfCounters::this_thread().read().has_value();
+    auto ps = points(600, 300);
+    auto vs = vecs(400, 300);
+    collect(process<Joined>(ps, vs));
+    auto profile = last_profile();
+    CHECK(profile->counters.has_value() == available);
+    CHECK(profile->self_counters().has_value() == available);
+    if (available) {
+        const auto& hc = profile->counters.value();
+        CHECK(not hc.counted[HardwareCounters::INSTRUCTIONS] or hc.values[HardwareCounters::INSTRUCTIONS] > 0);
+    }
+
+    HardwareCounters a, b;
+    a.values[HardwareCounters::CYCLES] = 10;
+    a.counted[HardwareCounters::CYCLES] = true;
+    b.values[HardwareCounters::CYCLES] = 20;
+    b.values[HardwareCounters::INSTRUCTIONS] = 30;
+    b.counted[HardwareCounters::INSTRUCTIONS] = true;
+    CHECK(not a.ipc());
+    a -= b;  // saturates
+    CHECK(a.values[HardwareCounters::CYCLES] == 0);
+    a += b;
+    CHECK(a.counted[HardwareCounters::INSTRUCTIONS] and a.ipc() == 1.5);
+}
+
+// one event per operator, and one per task of a parallel sort on the thread that ran it
+void test_trace() {
+    clear_trace();
+    auto ps = points(600, 300);
+    auto vs = vecs(400, 300);
+    collect(process<Joined>(ps, vs));
+    std::ostringstream os;
+    write_trace(os);
+    const std::string trace = os.str();
+    char query_id[17];
+    std::snprintf(query_id, sizeof(query_id), "%016llx", static_cast<unsigned long long>(Joined::query_id));
+    CHECK(occurrences(trace, "\"ph\": \"X\"") == 7);
+    CHECK(occurrences(trace, "\"query_id\": \"" + std::string(query_id) + "\"") == 7);
+    CHECK(occurrences(trace, "\"sql\": \"" + impl::json_escape(Joined::sql) + "\"") == 1);
+    CHECK(occurrences(trace, "\"name\": \"build [Point]\"") == 1);
+
+    clear_trace();
+    std::vector<std::tuple<int, int>> rows;
+    for (int i = 0; i < 4 * static_cast<int>(impl::parallel_sort_min_rows); ++i) {
+        rows.emplace_back((i * 7919) % 10007, i);
+    }
+    impl::sort_rows<std::tuple<int, int>, std::array<std::size_t, 1>{0}, std::array{false}>(rows, 4);
+    os.str("");
+    write_trace(os);
+    CHECK(occurrences(os.str(), "\"name\": \"sort chunk\"") == 4 and occurrences(os.str(), "\"name\": \"merge runs\"") == 3);
+    CHECK(occurrences(os.str(), "\"name\": \"thread_name\"") >= 4);
+    CHECK(impl::json_escape("a\"b\\\n") == "a\\\"b\\\\\\u000a");
+}
+
+int main() {
+    test_profile();
+    test_explain();
+    test_counters();
+    test_trace();
+    return result();
+}
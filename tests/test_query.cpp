@@ -0,0 +1,210 @@
+#include <map>
+#include <random>
+#include "planner.h"
+#include "index/sorted_index.h"
+#include "check.h"
+#include "schemas.h"
+
+// single queries run by process: filters, ordering, grouping and placeholders, against the rows computed by hand
+
+// a column that counts how often it is compared
+struct Meter {
+    int v{};
+    static inline int comparisons = 0;
+
+    friend bool operator<(const Meter& m, int64_t x) { ++comparisons; return m.v < x; }
+    friend bool operator>(const Meter& m, int64_t x) { ++comparisons; return m.v > x; }
+    friend bool operator<=(const Meter& m, int64_t x) { ++comparisons; return m.v <= x; }
+    friend bool operator>=(const Meter& m, int64_t x) { ++comparisons; return m.v >= x; }
+    friend bool operator==(const Meter& m, int64_t x) { ++comparisons; return m.v == x; }
+    friend bool operator!=(const Meter& m, int64_t x) { ++comparisons; return m.v != x; }
+};
+
+struct Probe {
+    int a{};
+    Meter m{};
+};
+
+REFL_AUTO(type(Probe), field(a), field(m))
+
+using namespace ctsql;
+using namespace ctsql::test;
+
+static constexpr char top_query[] = R"(SELECT x, y, name FROM Point WHERE y <> 3 ORDER BY y DESC, x, name LIMIT 10)";
+using Top = QueryPlanner<refl::make_const_string(top_query), Point>;
+static constexpr char first_query[] = R"(SELECT x FROM Point WHERE y > 1 LIMIT 4)";
+using First = QueryPlanner<refl::make_const_string(first_query), Point>;
+static constexpr char huge_limit_query[] = R"(SELECT x, y FROM Point ORDER BY x DESC LIMIT 2000000000)";
+using HugeLimit = QueryPlanner<refl::make_const_string(huge_limit_query), Point>;
+static constexpr char by_name_query[] = R"(SELECT name, x FROM Point WHERE x < 40 ORDER BY name DESC, x)";
+using ByName = QueryPlanner<refl::make_const_string(by_name_query), Point>;
+static constexpr char runs_query[] = R"(SELECT name, SUM(x), COUNT(*) FROM Point WHERE y <> 0 GROUP BY name)";
+using Runs = QueryPlanner<refl::make_const_string(runs_query), Point>;
+static constexpr char bound_query[] = R"(SELECT x, y FROM Point WHERE x > ? AND name = :nm OR y = ? AND name = :nm)";
+using Bound = QueryPlanner<refl::make_const_string(bound_query), Point>;
+static constexpr char bound_join_query[] = R"(SELECT Point.x, Vec.x2 FROM Point, Vec ON Point.name = Vec.name WHERE x2 > ? AND x < ?)";
+using BoundJoin = QueryPlanner<refl::make_const_string(bound_join_query), Point, Vec>;
+
+static constexpr char guarded_query[] = R"(SELECT a FROM Probe WHERE a > 5 AND m < 3)";
+using Guarded = QueryPlanner<refl::make_const_string(guarded_query), Probe>;
+static constexpr char fallback_query[] = R"(SELECT a FROM Probe WHERE a > 5 OR m < 3)";
+using Fallback = QueryPlanner<refl::make_const_string(fallback_query), Probe>;
+static constexpr char shared_query[] = R"(SELECT a FROM Probe WHERE a > 5 AND m < 3 OR a < 2 AND m < 3)";
+using Shared = QueryPlanner<refl::make_const_string(shared_query), Probe>;
+
+// atoms are evaluated in clause order and stop at the first that decides; only those of several clauses are
+// evaluated for every row
+void test_short_circuit() {
+    std::vector<SchemaTuple<Probe>> rows;
+    for (int i = 0; i < 10; ++i) {
+        rows.emplace_back(i, Meter{i % 4});
+    }
+    auto count = [&]<typename QP>(std::type_identity<QP>, std::size_t expected_rows) {
+        Meter::comparisons = 0;
+        CHECK(collect(process<QP>(rows)).size() == expected_rows);
+        return Meter::comparisons;
+    };
+    static_assert(Guarded::WhereAtoms::shared == 0 and Shared::WhereAtoms::shared != 0);
+    CHECK(count(std::type_identity<Guarded>{}, 3) == 4);  // of rows 6..9 only
+    CHECK(count(std::type_identity<Fallback>{}, 9) == 6);  // rows 0..5 only
+    CHECK(count(std::type_identity<Shared>{}, 5) == 10);
+}
+
+// a stream of rows that counts how many of them were read
+template<typename T>
+std::generator<T> counted(const std::vector<T>& rows, std::size_t& pulled) {
+    for (const auto& row: rows) {
+        ++pulled;
+        co_yield row;
+    }
+}
+
+// ORDER BY ... LIMIT keeps the best rows; a bare LIMIT stops reading its input once it has them
+void test_limit() {
+    auto ps = points(3000, 50);
+    std::vector<Top::ResultType> expected;
+    for (const auto& [x, y, mag, name]: ps) {
+        if (y != 3) {
+            expected.emplace_back(x, y, name);
+        }
+    }
+    std::sort(expected.begin(), expected.end(), [](const auto& l, const auto& r) {
+        return std::tuple(-std::get<1>(l), std::get<0>(l), std::get<2>(l)) < std::tuple(-std::get<1>(r), std::get<0>(r), std::get<2>(r));
+    });
+    expected.resize(10);
+    CHECK(collect(process<Top>(ps)) == expected);
+
+    std::size_t pulled = 0;
+    auto rows = counted(ps, pulled);
+    CHECK((collect(process<First>(rows)) == std::vector<First::ResultType>{{2}, {3}, {4}, {5}}));
+    CHECK(pulled == 6);  // rows 0 and 1 have y <= 1
+
+    // a limit past the input size keeps every row, and takes no memory by itself
+    auto two = points(2);
+    set_memory_budget(1 << 10);
+    CHECK((collect(process<HugeLimit>(two)) == std::vector<HugeLimit::ResultType>{{1, 1}, {0, 0}}));
+    set_memory_budget(0);
+}
+
+// integer and floating-point keys are radix sorted, other keys compared; large inputs are sorted in parallel chunks
+void test_order_by() {
+    using Row = std::tuple<int64_t, double, int>;
+    static_assert(impl::is_radix_sortable<Row, std::array<std::size_t, 2>{1, 0}>);
+    static_assert(not impl::is_radix_sortable<ByName::ResultType, ByName::order_indices_and_desc.first>);
+    std::mt19937_64 gen(42);
+    std::vector<Row> rows;
+    for (int i = 0; i < (1 << 18); ++i) {
+        rows.emplace_back(static_cast<int64_t>(gen() % 2001) - 1000, static_cast<double>(gen() % 501) / 4 - 60, i);
+    }
+    constexpr auto comp = impl::make_order_comparator<std::array<std::size_t, 2>{1, 0}, std::array{true, false}>();
+    for (std::size_t workers: {1, 4}) {
+        auto sorted_rows = rows;
+        impl::sort_rows<Row, std::array<std::size_t, 2>{1, 0}, std::array{true, false}>(sorted_rows, workers);
+        CHECK(std::is_sorted(sorted_rows.begin(), sorted_rows.end(), comp));
+        CHECK(sorted(sorted_rows) == sorted(rows));
+    }
+
+    auto ps = points(2000);
+    std::vector<ByName::ResultType> expected;
+    for (const auto& [x, y, mag, name]: ps) {
+        if (x < 40) {
+            expected.emplace_back(name, x);
+        }
+    }
+    std::sort(expected.begin(), expected.end(), [](const auto& l, const auto& r) {
+        return std::get<0>(l) != std::get<0>(r) ? std::get<0>(l) > std::get<0>(r) : std::get<1>(l) < std::get<1>(r);
+    });
+    CHECK(collect(process<ByName>(ps)) == expected);
+}
+
+// over an input clustered on the group keys, each group is out as soon as the next one starts
+void test_clustered_groups() {
+    auto ps = points(3000);
+    std::sort(ps.begin(), ps.end(), [](const auto& l, const auto& r) { return std::get<3>(l) < std::get<3>(r); });
+    std::map<std::string, std::pair<int, std::size_t>> groups;
+    for (const auto& [x, y, mag, name]: ps) {
+        if (y != 0) {
+            groups[name].first += x;
+            ++groups[name].second;
+        }
+    }
+    std::vector<Runs::ResultType> expected;
+    for (const auto& [name, g]: groups) {
+        expected.emplace_back(name, g.first, g.second);
+    }
+    auto input = clustered(ps);
+    CHECK(collect(process<Runs>(input)) == expected);
+
+    std::size_t pulled = 0;
+    auto rows = counted(ps, pulled);
+    auto clustered_rows = clustered(rows);
+    auto results = process<Runs>(clustered_rows);
+    CHECK(*results.begin() == expected[0]);
+    const auto first_run = std::ranges::count(ps, std::get<3>(ps[0]), [](const auto& t) { return std::get<3>(t); });
+    CHECK(pulled == static_cast<std::size_t>(first_run) + 1);
+}
+
+// placeholders take their values at run time, a repeated :name one value; index access paths are not taken for them
+void test_placeholders() {
+    auto ps = points(3000, 50);
+    auto expected = [&](int x, const std::string& nm, int y) {
+        std::vector<Bound::ResultType> rows;
+        for (const auto& [px, py, mag, name]: ps) {
+            if (name == nm and (px > x or py == y)) {
+                rows.emplace_back(px, py);
+            }
+        }
+        return rows;
+    };
+    CHECK(not expected(40, "aaa", 3).empty());
+    CHECK(collect(process<Bound>(ps, bind_params(40, std::string("aaa"), 3))) == expected(40, "aaa", 3));
+    CHECK(collect(process<Bound>(ps, bind_params(-1, std::string("ddd"), 0))) == expected(-1, "ddd", 0));
+    CHECK(collect(process<Bound>(ps, bind_params(100, std::string("q"), 0))).empty());
+
+    SortedIndex<Point, refl::make_const_string("x")> index(ps);
+    auto indexed = with_index(ps, index);
+    static_assert(impl::choose_access_path<Point, impl::WhereCNF<Bound>, decltype(indexed)>() == impl::AccessPath::FULL_SCAN);
+    CHECK(sorted(process<Bound>(indexed, bind_params(40, std::string("aaa"), 3))) == sorted(expected(40, "aaa", 3)));
+
+    auto few = points(300);
+    auto vs = vecs(100);
+    std::vector<BoundJoin::ResultType> joined;
+    for (const auto& [x, y, mag, name]: few) {
+        for (const auto& [x1, y1, x2, y2, vname]: vs) {
+            if (name == vname and x2 > 20 and x < 200) {
+                joined.emplace_back(x, x2);
+            }
+        }
+    }
+    CHECK(not joined.empty());
+    CHECK(sorted(process<BoundJoin>(few, vs, bind_params(20, 200))) == sorted(joined));
+}
+
+int main() {
+    test_short_circuit();
+    test_limit();
+    test_order_by();
+    test_clustered_groups();
+    test_placeholders();
+    return result();
+}
@@ -0,0 +1,36 @@
+#include "registered_queries.h"
+#include "check.h"
+
+// queries declared in a header run from a file that does not build the parser (registry.h)
+
+#ifdef SQL_PLANNER_H
+#error "the consumer of registered queries must not include planner.h"
+#endif
+
+using namespace ctsql::test;
+
+int main() {
+    auto ps = points(3000);
+    auto vs = vecs(500, 300);
+    std::vector<names_by_x::ResultType> names;
+    for (const auto& [x, y, mag, name]: ps) {
+        if (x > 990) {
+            names.emplace_back(name, x);
+        }
+    }
+    std::sort(names.begin(), names.end(), [](const auto& l, const auto& r) { return std::tie(std::get<1>(l), std::get<0>(l)) < std::tie(std::get<1>(r), std::get<0>(r)); });
+    CHECK(not names.empty());
+    CHECK(collect(names_by_x::run(ps)) == names);
+
+    std::vector<vec_names::ResultType> joined;
+    for (const auto& [x, y, mag, name]: ps) {
+        for (const auto& [x1, y1, x2, y2, vname]: vs) {
+            if (x == x1 and y2 < -5) {
+                joined.emplace_back(x, vname);
+            }
+        }
+    }
+    CHECK(not joined.empty());
+    CHECK(sorted(vec_names::run(ps, vs)) == sorted(joined));
+    return result();
+}
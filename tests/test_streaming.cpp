@@ -0,0 +1,153 @@
+#include <map>
+#include <span>
+#include "planner.h"
+#include "view/incremental_join.h"
+#include "view/materialized_view.h"
+#include "check.h"
+#include "schemas.h"
+
+// results kept up to date as rows arrive (view/) or computed per window of a stream (operator/window.h): they are
+// the results of process over the rows seen so far, or over the rows of each window
+
+struct Event {
+    int ts{};
+    int k{};
+    int v{};
+};
+
+REFL_AUTO(type(Event), field(ts), field(k), field(v))
+
+using namespace ctsql;
+using namespace ctsql::test;
+
+static constexpr char view_query[] = R"(SELECT name, SUM(x), COUNT(*), MIN(y), MAX(y) FROM Point WHERE x > 10 GROUP BY name ORDER BY name)";
+using View = QueryPlanner<refl::make_const_string(view_query), Point>;
+static constexpr char delta_join_query[] = R"(SELECT x, y, x1, y2 FROM Point, Vec ON Point.x = Vec.x1 WHERE y2 < -5 AND y < 10)";
+using DeltaJoin = QueryPlanner<refl::make_const_string(delta_join_query), Point, Vec>;
+static constexpr char windowed_query[] = R"(SELECT k, SUM(v), COUNT(*), MIN(v), MAX(v) FROM Event WHERE v <> 3 GROUP BY k)";
+using Windowed = QueryPlanner<refl::make_const_string(windowed_query), Event>;
+
+using Tumbling = TumblingWindow<refl::make_const_string("ts"), 10>;
+using Hopping = HoppingWindow<refl::make_const_string("ts"), 10, 4>;
+
+// inserts and erases touch only their groups; a group goes once its last row is erased
+void test_materialized_view() {
+    auto ps = points(3000, 50);
+    std::span all(ps);
+    auto first = all.first(2000);
+    MaterializedView<View> view(first);
+    CHECK(collect(view.result()) == collect(process<View>(first)));
+
+    auto erased = all.first(500);
+    view.erase(erased);
+    auto rest = all.subspan(2000);
+    view.insert(rest);
+    auto kept = all.subspan(500);
+    CHECK(collect(view.result()) == collect(process<View>(kept)));
+
+    // erasing the rows of every 'a' name drops their groups
+    std::vector<SchemaTuple<Point>> as;
+    for (const auto& p: kept) {
+        if (std::get<3>(p)[0] == 'a') {
+            as.push_back(p);
+        }
+    }
+    const std::size_t groups = view.num_groups();
+    view.erase(as);
+    CHECK(view.num_groups() < groups);
+    for (const auto& row: view.result()) {
+        CHECK(std::get<0>(row)[0] != 'a');
+    }
+    CHECK(throws<std::runtime_error>([&] { view.erase(as); }));
+}
+
+// the deltas of the appends to either side add up to the join of everything appended
+void test_incremental_join() {
+    auto ps = points(900, 300);
+    auto vs = vecs(600, 300);
+    std::span ls(ps);
+    std::span rs(vs);
+    IncrementalJoin<DeltaJoin> join;
+    std::vector<DeltaJoin::ResultType> joined;
+    for (std::size_t i = 0; i < 3; ++i) {
+        auto l = ls.subspan(i * 300, 300);
+        for (auto&& row: join.insert_left(l)) {
+            joined.push_back(row);
+        }
+        auto r = rs.subspan(i * 200, 200);
+        for (auto&& row: join.insert_right(r)) {
+            joined.push_back(row);
+        }
+    }
+    CHECK(not joined.empty());
+    CHECK(sorted(joined) == sorted(process<DeltaJoin>(ps, vs)));
+    CHECK(join.num_left() == static_cast<std::size_t>(std::ranges::count_if(ps, [](const auto& p) { return std::get<1>(p) < 10; })));
+}
+
+template<typename W>
+using WindowRow = typename impl::WindowAggregate<Windowed, W>::WindowRow;
+
+// the rows of every window that starts on a multiple of its slide, computed by hand
+template<typename W>
+std::vector<WindowRow<W>> windows_of(const std::vector<SchemaTuple<Event>>& events) {
+    constexpr int size = W::window_size, slide = W::window_slide;
+    std::vector<WindowRow<W>> rows;
+    for (int start = -(size + slide - 1) / slide * slide; start <= std::get<0>(events.back()); start += slide) {
+        std::map<int, WindowRow<W>> groups;
+        for (const auto& [ts, k, v]: events) {
+            if (ts < start or ts >= start + size or v == 3) {
+                continue;
+            }
+            auto [pos, fresh] = groups.try_emplace(k, start, k, 0, 0, v, v);
+            auto& [s, gk, sum, count, min, max] = pos->second;
+            sum += v;
+            ++count;
+            min = std::min(min, v);
+            max = std::max(max, v);
+        }
+        for (auto& [k, row]: groups) {
+            rows.push_back(row);
+        }
+    }
+    return rows;
+}
+
+// a window is out once an event at or past its end arrives, so unbounded inputs work
+void test_windows() {
+    std::vector<SchemaTuple<Event>> events;
+    for (int i = 0; i < 400; ++i) {
+        events.emplace_back(i / 4 + (i >= 200 ? 60 : 0), i % 3, i % 7);  // no events in [50, 110)
+    }
+    CHECK(sorted(process<Windowed, Tumbling>(events)) == windows_of<Tumbling>(events));
+    CHECK(sorted(process<Windowed, Hopping>(events)) == windows_of<Hopping>(events));
+
+    auto unbounded = []() -> std::generator<SchemaTuple<Event>> {
+        for (int i = 0; ; ++i) {
+            co_yield SchemaTuple<Event>(i / 4, i % 3, i % 7);
+        }
+    }();
+    std::vector<WindowRow<Tumbling>> first;
+    for (auto&& row: process<Windowed, Tumbling>(unbounded)) {
+        if (std::get<0>(row) == 20) {
+            break;
+        }
+        first.push_back(row);
+    }
+    std::vector<WindowRow<Tumbling>> expected;
+    for (const auto& row: windows_of<Tumbling>(events)) {
+        if (std::get<0>(row) < 20) {
+            expected.push_back(row);
+        }
+    }
+    CHECK(sorted(first) == expected);
+
+    std::vector<SchemaTuple<Event>> unordered{{5, 0, 1}, {3, 0, 1}};
+    CHECK(throws<std::runtime_error>([&] { collect(process<Windowed, Tumbling>(unordered)); }));
+}
+
+int main() {
+    test_materialized_view();
+    test_incremental_join();
+    test_windows();
+    return result();
+}